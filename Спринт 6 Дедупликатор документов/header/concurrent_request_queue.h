@@ -0,0 +1,45 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string_view>
+
+#include "search_server.h"
+
+// вариант RequestQueue для вызова из многих потоков: сами поиски идут параллельно,
+// окно последних min_in_day_ запросов хранится в кольцевом буфере атомарных ячеек;
+// индекс сервера не должен меняться, пока идут запросы
+class ConcurrentRequestQueue {
+public:
+    explicit ConcurrentRequestQueue(const SearchServer& search_server)
+        : search_server_(search_server) {
+    }
+
+    template <typename DocumentPredicate>
+    std::vector<Document> AddFindRequest(std::string_view raw_query, DocumentPredicate document_predicate, SearchOptions options = {})
+    {
+        const auto result = search_server_.FindTopDocuments(raw_query, document_predicate, options);
+        AddRequest(result.empty());
+        return result;
+    }
+    std::vector<Document> AddFindRequest(std::string_view raw_query, DocumentStatus status, SearchOptions options = {});
+    std::vector<Document> AddFindRequest(std::string_view raw_query);
+
+    // не ждёт других потоков; пока запросы продолжают поступать, значение может отставать от самых последних из них
+    int GetNoResultRequests() const
+    {
+        return no_results_requests_.load(std::memory_order_relaxed);
+    }
+private:
+    const static int min_in_day_ = 1440;
+
+    const SearchServer& search_server_;
+    std::atomic<uint64_t> current_time_{ 0 };
+    std::atomic<int> no_results_requests_{ 0 };
+    // запрос с временем t лежит в ячейке t % min_in_day_ и вытесняет запрос t - min_in_day_;
+    // в ячейке хранится время запроса, сдвинутое на один бит, и признак пустой выдачи в младшем бите
+    std::array<std::atomic<uint64_t>, min_in_day_> requests_{};
+
+    void AddRequest(bool no_results);
+};
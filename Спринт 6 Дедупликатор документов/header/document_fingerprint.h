@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string_view>
+
+#include "term_dictionary.h"
+
+// 128-битный отпечаток множества ключей: каждый ключ перемешивается двумя
+// независимыми хешами, и результаты складываются, поэтому порядок добавления не важен
+struct DocumentFingerprint {
+    uint64_t low = 0;
+    uint64_t high = 0;
+
+    // один и тот же ключ нельзя добавлять дважды: отпечаток строится для множества
+    void AddKey(uint64_t key);
+
+    // для наборов слов без TermId: половины отпечатка считаются разными хешами слова,
+    // поэтому совпадение одного 64-битного хеша у двух слов не склеивает отпечатки
+    void AddWord(std::string_view word);
+
+    bool operator==(const DocumentFingerprint& other) const
+    {
+        return low == other.low && high == other.high;
+    }
+
+    bool operator!=(const DocumentFingerprint& other) const
+    {
+        return !(*this == other);
+    }
+
+    bool operator<(const DocumentFingerprint& other) const
+    {
+        return high < other.high || (high == other.high && low < other.low);
+    }
+};
+
+struct DocumentFingerprintHasher {
+    size_t operator()(const DocumentFingerprint& fingerprint) const
+    {
+        return static_cast<size_t>(fingerprint.low);
+    }
+};
+
+// перемешивание 64-битного ключа (финализатор splitmix64): соседние ключи дают некоррелированные значения
+uint64_t MixKey(uint64_t key);
+
+// отпечаток набора слов документа без учёта частот
+DocumentFingerprint ComputeFingerprint(const std::map<TermId, double>& term_freqs);
+
+// точная проверка совпадения отпечатков: одинаковы ли наборы слов
+bool HaveSameTerms(const std::map<TermId, double>& lhs, const std::map<TermId, double>& rhs);
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <istream>
+#include <vector>
+
+#include "search_server.h"
+
+struct ExternalDedupOptions {
+    // сколько записей сортируется в памяти за раз; запись занимает 32 байта
+    size_t run_size = 1 << 20;
+    // сколько серий сливается за один проход; каждой открытой серии нужен буфер чтения
+    size_t merge_fan_in = 64;
+};
+
+// поиск дубликатов в корпусе, который не помещается в память: документы читаются из потока
+// по строке "id текст" (конец строки CRLF допустим), слова разбираются по правилам стоп-слов сервера, а отпечатки наборов
+// слов с номерами документов пишутся отсортированными сериями во временные файлы и сливаются;
+// памяти нужно на run_size записей, merge_fan_in буферов и сам результат
+//
+// возвращает id документов, повторяющих набор слов более раннего документа, в порядке входа;
+// при ошибке разбора строки выбрасывается std::invalid_argument с номером строки, при ошибке ввода-вывода std::runtime_error
+std::vector<int> FindDuplicatesExternal(std::istream& documents, const SearchServer& search_server,
+                                        const ExternalDedupOptions& options = {});
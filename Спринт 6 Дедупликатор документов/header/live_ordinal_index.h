@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "posting_list.h"
+
+// живые внутренние номера документов: дерево Фенвика над отметками "документ не удалён";
+// k-й по порядку живой номер находится за O(log n), отметка и добавление номера тоже за O(log n)
+class LiveOrdinalIndex {
+public:
+    // номера [0, count) живы
+    void Reset(size_t count);
+
+    // новый живой номер в конце
+    void Append();
+
+    void Erase(DocumentOrdinal ordinal);
+
+    // rank должен быть меньше числа живых номеров
+    DocumentOrdinal Select(size_t rank) const;
+
+private:
+    // tree_[i] - число живых номеров среди позиций (i - lowbit(i), i], позиции нумеруются с 1
+    std::vector<uint32_t> tree_ = { 0 };
+
+    // число живых номеров среди первых count
+    uint32_t CountPrefix(size_t count) const;
+};
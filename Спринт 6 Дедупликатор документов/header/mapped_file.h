@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+
+// файл, отображённый в память только для чтения; отображение живёт, пока жив объект
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile();
+
+    const char* data() const
+    {
+        return data_;
+    }
+
+    size_t size() const
+    {
+        return size_;
+    }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    void* file_ = nullptr;
+    void* mapping_ = nullptr;
+#endif
+};
@@ -1,14 +1,17 @@
 #pragma once
 
+#include <algorithm>
 #include <cassert>
+#include <iterator>
+#include <ostream>
+#include <type_traits>
 
 template <typename Iterator>
 class IteratorRange {
 public:
     IteratorRange(Iterator begin, Iterator end)
         : first_(begin)
-        , last_(end)
-        , size_(distance(first_, last_)) {
+        , last_(end) {
     }
 
     Iterator begin() const {
@@ -19,13 +22,13 @@ public:
         return last_;
     }
 
+    // считается по запросу: для итераторов без произвольного доступа это проход по диапазону
     size_t size() const {
-        return size_;
+        return std::distance(first_, last_);
     }
 
 private:
     Iterator first_, last_;
-    size_t size_;
 };
 
 template <typename Iterator>
@@ -36,41 +39,115 @@ std::ostream& operator<<(std::ostream& out, const IteratorRange<Iterator>& range
     return out;
 }
 
+// страницы не хранятся: граница очередной страницы находится при переходе на неё;
+// с итераторами произвольного доступа число страниц и страница по номеру вычисляются за O(1),
+// с прямыми итераторами (например, потоковая выдача) страницы перебираются по порядку
 template <typename Iterator>
 class Paginator {
 public:
-    Paginator(Iterator begin, Iterator end, size_t page_size) 
-    {
-        assert(end >= begin && page_size > 0);
+    static constexpr bool IS_RANDOM_ACCESS = std::is_base_of_v<std::random_access_iterator_tag,
+                                                               typename std::iterator_traits<Iterator>::iterator_category>;
+
+    // страница строится при переходе и хранится в самом итераторе, поэтому два равных итератора
+    // ссылаются на разные копии одной страницы; из-за этого итератор объявлен итератором ввода,
+    // хотя диапазон страниц можно обходить повторно
+    class PageIterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = IteratorRange<Iterator>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const IteratorRange<Iterator>*;
+        using reference = const IteratorRange<Iterator>&;
+
+        PageIterator(Iterator page_begin, Iterator end, size_t page_size)
+            : page_(page_begin, FindPageEnd(page_begin, end, page_size))
+            , end_(end)
+            , page_size_(page_size) {
+        }
+
+        reference operator*() const {
+            return page_;
+        }
+
+        pointer operator->() const {
+            return &page_;
+        }
+
+        PageIterator& operator++() {
+            page_ = { page_.end(), FindPageEnd(page_.end(), end_, page_size_) };
+            return *this;
+        }
+
+        PageIterator operator++(int) {
+            PageIterator previous = *this;
+            ++*this;
+            return previous;
+        }
 
-        for (size_t left = distance(begin, end); left > 0;) 
-        {
-            const size_t current_page_size = std::min(page_size, left);
-            const Iterator current_page_end = next(begin, current_page_size);
-            pages_.push_back({ begin, current_page_end });
+        bool operator==(const PageIterator& other) const {
+            return page_.begin() == other.page_.begin();
+        }
+
+        bool operator!=(const PageIterator& other) const {
+            return !(*this == other);
+        }
 
-            left -= current_page_size;
-            begin = current_page_end;
+    private:
+        IteratorRange<Iterator> page_;
+        Iterator end_;
+        size_t page_size_;
+    };
+
+    Paginator(Iterator begin, Iterator end, size_t page_size)
+        : begin_(begin)
+        , end_(end)
+        , page_size_(page_size)
+    {
+        assert(page_size > 0);
+        if constexpr (IS_RANDOM_ACCESS) {
+            assert(end >= begin);
         }
     }
 
-    auto begin() const {
-        return pages_.begin();
+    PageIterator begin() const {
+        return PageIterator(begin_, end_, page_size_);
     }
 
-    auto end() const {
-        return pages_.end();
+    PageIterator end() const {
+        return PageIterator(end_, end_, page_size_);
     }
 
+    // для итераторов без произвольного доступа - проход по всему диапазону
     size_t size() const {
-        return pages_.size();
+        return (static_cast<size_t>(std::distance(begin_, end_)) + page_size_ - 1) / page_size_;
+    }
+
+    IteratorRange<Iterator> operator[](size_t page_index) const {
+        static_assert(IS_RANDOM_ACCESS, "Page access by index requires random access iterators");
+        assert(page_index < size());
+        const Iterator page_begin = begin_ + static_cast<std::ptrdiff_t>(page_index * page_size_);
+        return { page_begin, FindPageEnd(page_begin, end_, page_size_) };
     }
 
 private:
-    std::vector<IteratorRange<Iterator>> pages_;
+    Iterator begin_;
+    Iterator end_;
+    size_t page_size_;
+
+    static Iterator FindPageEnd(Iterator page_begin, Iterator end, size_t page_size) {
+        if constexpr (IS_RANDOM_ACCESS) {
+            return page_begin + static_cast<std::ptrdiff_t>(std::min<size_t>(page_size, end - page_begin));
+        }
+        else {
+            for (size_t i = 0; i < page_size && page_begin != end; ++i) {
+                ++page_begin;
+            }
+            return page_begin;
+        }
+    }
 };
 
 template <typename Container>
 auto Paginate(const Container& c, size_t page_size) {
-    return Paginator(begin(c), end(c), page_size);
-}
\ No newline at end of file
+    return Paginator(std::begin(c), std::end(c), page_size);
+}
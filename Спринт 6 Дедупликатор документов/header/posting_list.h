@@ -0,0 +1,182 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <execution>
+#include <vector>
+
+// внутренний плотный номер документа в порядке добавления
+using DocumentOrdinal = uint32_t;
+
+// список вхождений терма: номера документов по возрастанию и частоты терма в отдельных массивах;
+// записи удалённых документов остаются в списке, пока их не больше живых, поэтому обход
+// через ForEach и Cursor должен сам пропускать удалённые документы
+//
+// после Compress полные блоки по BLOCK_SIZE записей хранятся сжатыми: разности соседних номеров
+// упакованы с общей для блока шириной в битах, частоты округлены до float; новые записи
+// копятся в несжатом хвосте и запечатываются в блок, когда хвост заполнится
+class PostingList {
+public:
+    static const size_t BLOCK_SIZE = 128;
+
+    struct DecodedBlock {
+        DocumentOrdinal ordinals[BLOCK_SIZE];
+        double term_freqs[BLOCK_SIZE];
+    };
+
+    // курсор для обхода документ за документом с пропуском заведомо ненужных записей;
+    // сжатые блоки распаковываются по одному, а блоки целиком левее нужного номера пропускаются без распаковки
+    class Cursor {
+    public:
+        explicit Cursor(const PostingList& postings);
+
+        bool IsEnd() const
+        {
+            return block_index_ == postings_->blocks_.size() && index_ >= postings_->ordinals_.size();
+        }
+
+        DocumentOrdinal GetOrdinal() const
+        {
+            return IsInBlock() ? decoded_.ordinals[index_] : postings_->ordinals_[index_];
+        }
+
+        double GetTermFreq() const
+        {
+            return IsInBlock() ? decoded_.term_freqs[index_] : postings_->term_freqs_[index_];
+        }
+
+        void Next();
+
+        // переходит к первому документу с номером не меньше ordinal
+        void SkipTo(DocumentOrdinal ordinal);
+
+    private:
+        const PostingList* postings_;
+        size_t block_index_ = 0;
+        size_t index_ = 0;
+        DecodedBlock decoded_;
+
+        bool IsInBlock() const
+        {
+            return block_index_ < postings_->blocks_.size();
+        }
+
+        void EnterBlock(size_t block_index);
+    };
+
+    // обычно документ новее всех уже добавленных, тогда запись сводится к push_back
+    void Add(DocumentOrdinal ordinal, double term_freq);
+
+    // заменяет содержимое списка готовыми массивами; номера должны идти по возрастанию
+    void Assign(const DocumentOrdinal* ordinals, const double* term_freqs, size_t count);
+
+    // вызывается после того, как removed_count документов из списка отмечены в removed; когда удалённых
+    // записей становится больше живых, список уплотняется за время, пропорциональное его длине
+    void MarkRemoved(const std::vector<bool>& removed, size_t removed_count = 1);
+
+    // выбрасывает записи документов, отмеченных в removed, и переводит оставшиеся номера через new_ordinals;
+    // отображение должно сохранять порядок номеров
+    void Renumber(const std::vector<bool>& removed, const std::vector<DocumentOrdinal>& new_ordinals);
+
+    // переводит список в сжатый формат; последующие добавления тоже сжимаются
+    void Compress();
+
+    template <typename Callback>
+    void ForEach(Callback callback) const
+    {
+        DecodedBlock decoded;
+        for (size_t block_index = 0; block_index < blocks_.size(); ++block_index)
+        {
+            DecodeBlock(block_index, decoded);
+            for (size_t i = 0; i < BLOCK_SIZE; ++i)
+            {
+                callback(decoded.ordinals[i], decoded.term_freqs[i]);
+            }
+        }
+        for (size_t i = 0; i < ordinals_.size(); ++i)
+        {
+            callback(ordinals_[i], term_freqs_[i]);
+        }
+    }
+
+    // при параллельной политике callback вызывается одновременно из разных потоков,
+    // сжатые блоки распаковываются параллельно
+    template <typename ExecutionPolicy, typename Callback>
+    void ForEach(ExecutionPolicy&& policy, Callback callback) const
+    {
+        std::for_each(policy, blocks_.begin(), blocks_.end(), [this, &callback](const Block& block) {
+            DecodedBlock decoded;
+            DecodeBlock(&block - blocks_.data(), decoded);
+            for (size_t i = 0; i < BLOCK_SIZE; ++i)
+            {
+                callback(decoded.ordinals[i], decoded.term_freqs[i]);
+            }
+        });
+        std::for_each(policy, ordinals_.begin(), ordinals_.end(), [this, &callback](const DocumentOrdinal& ordinal) {
+            callback(ordinal, term_freqs_[&ordinal - ordinals_.data()]);
+        });
+    }
+
+    Cursor GetCursor() const
+    {
+        return Cursor(*this);
+    }
+
+    // верхняя граница частоты терма; после удалений может быть завышена, но не занижена
+    double GetMaxTermFreq() const
+    {
+        return max_term_freq_;
+    }
+
+    // число живых документов со словом
+    size_t size() const
+    {
+        return blocks_.size() * BLOCK_SIZE + ordinals_.size() - removed_count_;
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    // байты, занятые списком, вместе с зарезервированной памятью векторов
+    size_t GetMemoryUsage() const;
+
+private:
+    struct Block {
+        DocumentOrdinal first_ordinal;
+        DocumentOrdinal last_ordinal;
+        // начало упакованных разностей блока в packed_deltas_
+        uint32_t delta_offset;
+        uint32_t bit_width;
+    };
+
+    // несжатый хвост; пока Compress не вызывался, здесь лежит весь список
+    std::vector<DocumentOrdinal> ordinals_;
+    std::vector<double> term_freqs_;
+
+    std::vector<Block> blocks_;
+    std::vector<uint32_t> packed_deltas_;
+    // частоты блока block_index начинаются с block_index * BLOCK_SIZE
+    std::vector<float> block_term_freqs_;
+    bool compressed_ = false;
+
+    double max_term_freq_ = 0.0;
+    size_t removed_count_ = 0;
+
+    DocumentOrdinal GetLastOrdinal() const
+    {
+        return ordinals_.empty() ? blocks_.back().last_ordinal : ordinals_.back();
+    }
+
+    void DecodeBlock(size_t block_index, DecodedBlock& decoded) const;
+
+    // запечатывает в блоки все полные куски хвоста
+    void SealFullBlocks();
+
+    // возвращает все записи в несжатый хвост
+    void Decompress();
+
+    // оставляет только записи живых документов, при new_ordinals != nullptr заменяя их номера
+    void DropRemoved(const std::vector<bool>& removed, const std::vector<DocumentOrdinal>* new_ordinals);
+};
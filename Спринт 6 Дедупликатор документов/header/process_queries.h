@@ -0,0 +1,102 @@
+#pragma once
+
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+
+// запросы обрабатываются параллельно, результаты идут в порядке запросов;
+// если запросы некорректны, выбрасывается исключение первого из них
+std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_server, const std::vector<std::string>& queries);
+
+// плоская последовательность документов поверх результатов отдельных запросов, в порядке запросов:
+// результаты не копируются в общий контейнер, итератор сам переходит между ними
+class JoinedDocuments {
+public:
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Document;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Document*;
+        using reference = const Document&;
+
+        Iterator() = default;
+
+        Iterator(const std::vector<std::vector<Document>>* results, size_t query_index)
+            : results_(results)
+            , query_index_(query_index) {
+            SkipEmptyResults();
+        }
+
+        reference operator*() const {
+            return (*results_)[query_index_][document_index_];
+        }
+
+        pointer operator->() const {
+            return &**this;
+        }
+
+        Iterator& operator++() {
+            if (++document_index_ == (*results_)[query_index_].size()) {
+                ++query_index_;
+                document_index_ = 0;
+                SkipEmptyResults();
+            }
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        bool operator==(const Iterator& other) const {
+            return query_index_ == other.query_index_ && document_index_ == other.document_index_;
+        }
+
+        bool operator!=(const Iterator& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        const std::vector<std::vector<Document>>* results_ = nullptr;
+        size_t query_index_ = 0;
+        size_t document_index_ = 0;
+
+        void SkipEmptyResults() {
+            while (query_index_ < results_->size() && (*results_)[query_index_].empty()) {
+                ++query_index_;
+            }
+        }
+    };
+
+    explicit JoinedDocuments(std::vector<std::vector<Document>> results)
+        : results_(std::move(results)) {
+        for (const std::vector<Document>& documents : results_) {
+            size_ += documents.size();
+        }
+    }
+
+    Iterator begin() const {
+        return Iterator(&results_, 0);
+    }
+
+    Iterator end() const {
+        return Iterator(&results_, results_.size());
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+private:
+    std::vector<std::vector<Document>> results_;
+    size_t size_ = 0;
+};
+
+// если запросы некорректны, выбрасывается исключение первого из них, как в ProcessQueries
+JoinedDocuments ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries);
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "search_server.h"
+
+// запрос не успел начаться до своего крайнего срока и был отменён
+class QueryDeadlineExceeded : public std::runtime_error {
+public:
+    QueryDeadlineExceeded()
+        : std::runtime_error("Query deadline exceeded") {
+    }
+};
+
+// пул потоков для поисковых запросов: задачи попадают в ограниченную очередь,
+// результат возвращается через std::future; индекс сервера не должен меняться, пока есть задачи
+class QueryExecutor {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr Clock::time_point NO_DEADLINE = Clock::time_point::max();
+    static const size_t DEFAULT_QUEUE_CAPACITY = 1024;
+
+    // при заполненной очереди Submit ждёт, пока рабочие потоки разберут задачи
+    explicit QueryExecutor(const SearchServer& search_server, size_t thread_count = std::thread::hardware_concurrency(),
+                           size_t queue_capacity = DEFAULT_QUEUE_CAPACITY);
+
+    QueryExecutor(const QueryExecutor&) = delete;
+    QueryExecutor& operator=(const QueryExecutor&) = delete;
+
+    // выполняет уже принятые задачи и останавливает потоки
+    ~QueryExecutor();
+
+    // задача, не начатая до deadline, не выполняется, а future получает QueryDeadlineExceeded;
+    // исключение из самой задачи тоже передаётся через future
+    template <typename Task>
+    std::future<std::invoke_result_t<Task>> Submit(Task task, Clock::time_point deadline = NO_DEADLINE);
+
+    std::future<std::vector<Document>> SubmitFindTopDocuments(std::string raw_query, Clock::time_point deadline = NO_DEADLINE);
+
+    std::future<std::vector<Document>> SubmitFindTopDocuments(std::string raw_query, DocumentStatus status,
+                                                              Clock::time_point deadline = NO_DEADLINE);
+
+    std::future<SearchServer::MatchedWords> SubmitMatchDocument(std::string raw_query, int document_id,
+                                                                Clock::time_point deadline = NO_DEADLINE);
+
+private:
+    struct PendingTask {
+        Clock::time_point deadline;
+        // аргумент - истёк ли крайний срок к моменту начала
+        std::function<void(bool)> run;
+    };
+
+    const SearchServer& search_server_;
+    const size_t queue_capacity_;
+
+    std::mutex mutex_;
+    std::condition_variable has_tasks_;
+    std::condition_variable has_space_;
+    std::deque<PendingTask> tasks_;
+    bool stopping_ = false;
+
+    std::vector<std::thread> workers_;
+
+    void Enqueue(PendingTask task);
+
+    void RunWorker();
+};
+
+template <typename Task>
+std::future<std::invoke_result_t<Task>> QueryExecutor::Submit(Task task, Clock::time_point deadline)
+{
+    using Result = std::invoke_result_t<Task>;
+    // std::function требует копируемости, поэтому обещание разделяется через shared_ptr
+    auto promise = std::make_shared<std::promise<Result>>();
+    auto future = promise->get_future();
+    Enqueue({ deadline, [promise, task = std::move(task)](bool expired) mutable {
+        if (expired)
+        {
+            promise->set_exception(std::make_exception_ptr(QueryDeadlineExceeded()));
+            return;
+        }
+        try
+        {
+            if constexpr (std::is_void_v<Result>)
+            {
+                task();
+                promise->set_value();
+            }
+            else
+            {
+                promise->set_value(task());
+            }
+        }
+        catch (...)
+        {
+            promise->set_exception(std::current_exception());
+        }
+    } });
+    return future;
+}
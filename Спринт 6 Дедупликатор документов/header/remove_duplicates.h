@@ -1,5 +1,26 @@
 #pragma once
 
+#include <vector>
+
 #include "search_server.h"
 
-void RemoveDuplicates(SearchServer & search_server);
\ No newline at end of file
+void RemoveDuplicates(SearchServer & search_server);
+
+struct NearDuplicateOptions {
+    // документы почти одинаковы, если коэффициент Жаккара их наборов слов не меньше порога
+    double jaccard_threshold = 0.8;
+    // сигнатура MinHash из band_count полос по rows_per_band значений; пара с коэффициентом s
+    // сравнивается точно с вероятностью 1 - (1 - s^rows_per_band)^band_count
+    size_t band_count = 32;
+    size_t rows_per_band = 4;
+};
+
+// кластеры из двух и более почти одинаковых документов; id внутри кластера и сами кластеры
+// идут в порядке добавления документов, первый документ кластера - его представитель,
+// и коэффициент Жаккара каждого члена с представителем не ниже порога (членов между собой
+// никто не сравнивает); документ попадает к самому раннему из подходящих представителей.
+// при недопустимых параметрах выбрасывается std::invalid_argument
+std::vector<std::vector<int>> FindNearDuplicates(const SearchServer& search_server, const NearDuplicateOptions& options = {});
+
+// оставляет от каждого кластера только представителя
+void RemoveNearDuplicates(SearchServer& search_server, const NearDuplicateOptions& options = {});
@@ -1,33 +1,77 @@
 #pragma once
 
 #include <deque> 
+#include <list>
+#include <string_view>
+#include <type_traits>
+#include <typeindex>
+#include <unordered_map>
 
 #include "search_server.h"
 
+// отметка для AddFindRequest: выдача предиката зависит только от его аргументов,
+// поэтому её можно кешировать по типу предиката
+struct PurePredicateTag {};
+
+const PurePredicateTag PURE_PREDICATE{};
 
 class RequestQueue {
 public:
-    explicit RequestQueue(const SearchServer& search_server)
+    static const size_t DEFAULT_CACHE_CAPACITY = 1024;
+
+    struct CacheStats {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t entries = 0;
+        // приблизительный объём памяти под ключи, результаты и служебные узлы
+        size_t memory_usage = 0;
+
+        double GetHitRatio() const
+        {
+            return hits + misses == 0 ? 0.0 : static_cast<double>(hits) / (hits + misses);
+        }
+    };
+
+    // cache_capacity - наибольшее число запомненных выдач, 0 отключает кеш
+    explicit RequestQueue(const SearchServer& search_server, size_t cache_capacity = DEFAULT_CACHE_CAPACITY)
         : search_server_(search_server)
         , no_results_requests_(0)
-        , current_time_(0) {
+        , current_time_(0)
+        , cache_capacity_(cache_capacity) {
     }
-    // сделаем "обертки" для всех методов поиска, чтобы сохранять результаты для нашей статистики
+    // сделаем "обертки" для всех методов поиска, чтобы сохранять результаты для нашей статистики;
+    // предикат может читать внешнее состояние, например список запретов или часы, поэтому его выдача не кешируется
     template <typename DocumentPredicate>
-    std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate)
+    std::vector<Document> AddFindRequest(std::string_view raw_query, DocumentPredicate document_predicate, SearchOptions options = {})
     {
-        const auto result = search_server_.FindTopDocuments(raw_query, document_predicate);
+        const auto result = search_server_.FindTopDocuments(raw_query, document_predicate, options);
         AddRequest(result.size());
-
         return result;
     }
-    std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentStatus status);
-    std::vector<Document> AddFindRequest(const std::string& raw_query);
+
+    // кеширование выдачи предиката включается явно отметкой PURE_PREDICATE; предикат должен быть без состояния
+    // и без обращений к изменяемым внешним данным, тогда одинаковый тип означает одинаковое поведение
+    template <typename DocumentPredicate>
+    std::vector<Document> AddFindRequest(std::string_view raw_query, DocumentPredicate document_predicate, PurePredicateTag,
+                                         SearchOptions options = {})
+    {
+        static_assert(std::is_empty_v<DocumentPredicate>, "Only stateless predicates can be cached by type");
+        return AddCachedRequest(raw_query, typeid(DocumentPredicate), DocumentStatus::ACTUAL, options, [&] {
+            return search_server_.FindTopDocuments(raw_query, document_predicate, options);
+        });
+    }
+    std::vector<Document> AddFindRequest(std::string_view raw_query, DocumentStatus status, SearchOptions options = {});
+    std::vector<Document> AddFindRequest(std::string_view raw_query);
 
     int GetNoResultRequests() const
     {
         return no_results_requests_;
     }
+
+    CacheStats GetCacheStats() const
+    {
+        return cache_stats_;
+    }
 private:
     struct QueryResult
     {
@@ -35,11 +79,73 @@ private:
         int results;
     };
 
+    // статусный поиск помечается типом void вместо типа предиката
+    struct CacheKey
+    {
+        std::vector<TermId> query;
+        std::type_index predicate_type;
+        DocumentStatus status;
+        size_t offset;
+        size_t limit;
+        SearchEngine engine;
+
+        bool operator==(const CacheKey& other) const;
+    };
+
+    struct CacheKeyHasher
+    {
+        size_t operator()(const CacheKey& key) const;
+    };
+
+    struct CacheEntry
+    {
+        CacheKey key;
+        std::vector<Document> documents;
+    };
+
     std::deque<QueryResult> requests_;
     const SearchServer& search_server_;
     int no_results_requests_;
     uint64_t current_time_;
     const static int min_in_day_ = 1440;
 
+    const size_t cache_capacity_;
+    // в начале списка последние использованные выдачи
+    std::list<CacheEntry> cache_entries_;
+    std::unordered_map<CacheKey, std::list<CacheEntry>::iterator, CacheKeyHasher> cache_index_;
+    // поколение индекса, для которого действительны записи кеша
+    uint64_t cache_generation_ = 0;
+    CacheStats cache_stats_;
+
     void AddRequest(int results_num);
-};
\ No newline at end of file
+
+    template <typename Search>
+    std::vector<Document> AddCachedRequest(std::string_view raw_query, std::type_index predicate_type, DocumentStatus status,
+                                           SearchOptions options, Search search)
+    {
+        if (cache_capacity_ == 0)
+        {
+            const auto result = search();
+            AddRequest(result.size());
+            return result;
+        }
+
+        CacheKey key{ search_server_.NormalizeQuery(raw_query), predicate_type, status, options.offset, options.limit, options.engine };
+        if (const auto* cached = FindInCache(key))
+        {
+            AddRequest(cached->size());
+            return *cached;
+        }
+        auto result = search();
+        AddRequest(result.size());
+        PutInCache(std::move(key), result);
+        return result;
+    }
+
+    // nullptr, если выдачи нет или индекс изменился с момента её сохранения
+    const std::vector<Document>* FindInCache(const CacheKey& key);
+
+    void PutInCache(CacheKey key, const std::vector<Document>& documents);
+
+    static size_t GetEntryMemoryUsage(const CacheEntry& entry);
+};
@@ -2,12 +2,66 @@
 
 #include <map>
 #include <algorithm>
-
+#include <cstdint>
+#include <execution>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+
+#include "concurrent_map.h"
 #include "document.h"
+#include "document_fingerprint.h"
+#include "live_ordinal_index.h"
+#include "posting_list.h"
+#include "stop_word_set.h"
 #include "string_processing.h"
+#include "term_dictionary.h"
 
 const double EPSILON = 1e-6;
 
+enum class SearchEngine {
+    // полный подсчёт релевантности всех документов со словами запроса
+    EXHAUSTIVE,
+    // MaxScore: документы, которые не могут попасть в окно выдачи, пропускаются без подсчёта
+    MAX_SCORE,
+};
+
+// окно выдачи: сколько лучших документов пропустить и сколько вернуть
+struct SearchOptions {
+    size_t offset = 0;
+    size_t limit = MAX_RESULT_DOCUMENT_COUNT;
+    SearchEngine engine = SearchEngine::EXHAUSTIVE;
+};
+
+// документ для пакетной загрузки; текст должен жить до конца вызова AddDocuments
+struct DocumentToAdd {
+    int id;
+    std::string_view text;
+    DocumentStatus status;
+    std::vector<int> ratings;
+};
+
+// что делать с документом, набор слов которого совпадает с уже проиндексированным
+enum class DuplicatePolicy {
+    // дубликат индексируется как обычный документ
+    ALLOW,
+    // AddDocument выбрасывает std::invalid_argument, пакет AddDocuments отклоняется целиком
+    REJECT,
+    // дубликат не индексируется, пара id попадает в отчёт TakeDuplicateReport
+    REPORT,
+    // дубликат не индексируется, его id становится псевдонимом оригинала
+    ALIAS,
+};
+
+struct DuplicateDocument {
+    int id;
+    int original_id;
+};
+
 class SearchServer {
 public:
 
@@ -17,117 +71,292 @@ public:
 
     explicit SearchServer(const std::string& stop_words_text);
 
-    void AddDocument(int document_id, const std::string& document, DocumentStatus status, const std::vector<int>& ratings);
+    explicit SearchServer(std::string_view stop_words_text);
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+
+    // пакет добавляется целиком или не добавляется вовсе: все ошибки обнаруживаются до изменения индекса
+    void AddDocuments(const std::vector<DocumentToAdd>& documents);
+
+    void AddDocuments(std::execution::sequenced_policy, const std::vector<DocumentToAdd>& documents);
+
+    // разбор текстов и построение частичных индексов по кускам пакета идут параллельно
+    void AddDocuments(std::execution::parallel_policy, const std::vector<DocumentToAdd>& documents);
 
     template <typename DocumentPredicate>
-    std::vector<Document> FindTopDocuments(const std::string& raw_query, DocumentPredicate document_predicate) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, SearchOptions options = {}) const;
 
-    std::vector<Document> FindTopDocuments(const std::string& raw_query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status, SearchOptions options = {}) const;
 
-    std::vector<Document> FindTopDocuments(const std::string& raw_query) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
 
-    int GetDocumentCount() const 
+    // при параллельной политике предикат вызывается одновременно из разных потоков
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentPredicate document_predicate,
+                                           SearchOptions options = {}) const;
+
+    template <typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentStatus status,
+                                           SearchOptions options = {}) const;
+
+    template <typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query) const;
+
+    // при любой политике, кроме ALLOW, сервер хранит отпечатки наборов слов, и дубликат находится
+    // за время, пропорциональное длине документа; при включении отпечатки строятся по всем документам
+    void SetDuplicatePolicy(DuplicatePolicy policy);
+
+    DuplicatePolicy GetDuplicatePolicy() const
     {
-        return static_cast<int>(document_ids_.size());
+        return duplicate_policy_;
     }
 
-    int GetDocumentId(int index) const {
-        return document_ids_.at(index);
-    }
+    // дубликаты, пропущенные с политикой REPORT после предыдущего вызова
+    std::vector<DuplicateDocument> TakeDuplicateReport();
 
-    
-    std::vector<int>::const_iterator  begin() const
+    // id оригинала для псевдонима, для остальных id - сам id; псевдоним не виден в выдаче и обходе,
+    // но MatchDocument и GetWordFrequencies по нему отвечают данными оригинала;
+    // удаление псевдонима не трогает оригинал, а удаление оригинала удаляет и его псевдонимы
+    int ResolveDocumentId(int document_id) const;
+
+    // меняется при каждом изменении индекса, так внешние кеши узнают об устаревших результатах
+    uint64_t GetGeneration() const
     {
-        return document_ids_.begin();
+        return generation_;
     }
 
-    std::vector<int>::const_iterator end() const
+    // канонический вид запроса: плюс-термы по возрастанию, затем max() от TermId и минус-термы по возрастанию;
+    // при одном поколении индекса запросы с равным видом дают одинаковую выдачу
+    std::vector<TermId> NormalizeQuery(std::string_view raw_query) const;
+
+    // id документов в порядке добавления; удалённые документы пропускаются,
+    // после удаления документов итераторы недействительны
+    class DocumentIdIterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = int;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const int*;
+        using reference = const int&;
+
+        DocumentIdIterator(const SearchServer* server, DocumentOrdinal ordinal)
+            : server_(server)
+            , ordinal_(ordinal) {
+            SkipRemoved();
+        }
+
+        reference operator*() const {
+            return server_->ordinal_to_id_[ordinal_];
+        }
+
+        pointer operator->() const {
+            return &**this;
+        }
+
+        DocumentIdIterator& operator++() {
+            ++ordinal_;
+            SkipRemoved();
+            return *this;
+        }
+
+        DocumentIdIterator operator++(int) {
+            DocumentIdIterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        bool operator==(const DocumentIdIterator& other) const {
+            return ordinal_ == other.ordinal_;
+        }
+
+        bool operator!=(const DocumentIdIterator& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        const SearchServer* server_;
+        DocumentOrdinal ordinal_;
+
+        void SkipRemoved() {
+            while (ordinal_ < server_->removed_.size() && server_->removed_[ordinal_]) {
+                ++ordinal_;
+            }
+        }
+    };
+
+    int GetDocumentCount() const 
     {
-        return document_ids_.end();
+        return static_cast<int>(document_ordinals_.size());
     }
 
-    std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(const std::string& raw_query, int document_id) const;
+    // index-й живой документ в порядке добавления, ищется за O(log n)
+    int GetDocumentId(int index) const;
 
-    void RemoveDocument( int document_id) 
+    DocumentIdIterator begin() const
     {
-        if (documents_.count(document_id) != 0) 
-        {
-            std::vector<std::string> words(document_to_word_freqs_.at(document_id).size());
-            std::transform(document_to_word_freqs_.at(document_id).begin(),
-                document_to_word_freqs_.at(document_id).end(), words.begin(), [](auto& word)
-                {
-                    return word.first;
-                });
-
-            std::for_each( words.begin(), words.end(), [this, document_id](auto& word_view) 
-            {
-                    word_to_document_freqs_.find(word_view)->second.erase(document_id);
-             });
-
-
-            std::for_each(words.begin(), words.end(), [this, document_id](auto& word_view) {
-                auto it = word_to_document_freqs_.find(word_view);
-                if (it->second.empty()) 
-                {
-                    word_to_document_freqs_.erase(it);
-                }
-                });
-
-            documents_.erase(document_id);
-            for (int i = 0; i < document_ids_.size(); i++)
-            {
-                if (document_ids_[i] == document_id)
-                {
-                    document_ids_.erase( document_ids_.begin()+i );
-                    break;
-                }
-            }
-          //  document_ids_.erase(document_ids_.begin()+document_id-1);
-            document_to_word_freqs_.erase(document_id);
-        }
+        return DocumentIdIterator(this, 0);
     }
-    const std::map<std::string, double>& GetWordFrequencies(int document_id) const;
 
-private:
-    struct DocumentData 
+    DocumentIdIterator end() const
     {
-        int rating;
-        DocumentStatus status;
-    };
+        return DocumentIdIterator(this, static_cast<DocumentOrdinal>(ordinal_to_id_.size()));
+    }
+
+    // найденные слова упорядочены по алфавиту и ссылаются на словарь сервера: они действительны, пока жив сервер
+    using MatchedWords = std::tuple<std::vector<std::string_view>, DocumentStatus>;
+
+    MatchedWords MatchDocument(std::string_view raw_query, int document_id) const;
+
+    MatchedWords MatchDocument(std::execution::sequenced_policy, std::string_view raw_query, int document_id) const;
+
+    MatchedWords MatchDocument(std::execution::parallel_policy, std::string_view raw_query, int document_id) const;
+
+    // время удаления зависит только от числа слов документа, а не от размера индекса
+    void RemoveDocument(int document_id);
+
+    void RemoveDocument(std::execution::sequenced_policy, int document_id);
+
+    // списки вхождений разных слов документа обновляются параллельно
+    void RemoveDocument(std::execution::parallel_policy, int document_id);
 
-    const std::set<std::string> stop_words_;
-    std::map<std::string, std::map<int, double>> word_to_document_freqs_;
-    std::map<int, DocumentData> documents_;
-    std::vector<int> document_ids_;
-    std::map<int, std::map<std::string, double>> document_to_word_freqs_;
+    // пакетное удаление: каждый список вхождений обновляется один раз на всю пачку; неизвестные id пропускаются
+    void RemoveDocuments(const std::vector<int>& document_ids);
 
-    bool IsStopWord(const std::string& word) const;
+    // в снимок попадают только живые документы с их псевдонимами, политика дубликатов и режим сжатия списков вхождений,
+    // внутренние номера уплотняются
+    void SaveSnapshot(const std::string& path) const;
 
-    static bool IsValidWord(const std::string& word);
+    // файл отображается в память, и индекс собирается копированием готовых массивов без разбора текстов;
+    // при повреждённом или несовместимом файле выбрасывается std::runtime_error
+    static SearchServer LoadSnapshot(const std::string& path);
 
-    std::vector<std::string> SplitIntoWordsNoStop(const std::string& text) const;
+    // списки вхождений переводятся в сжатый формат, и новые документы тоже индексируются сжато;
+    // частоты слов при этом округляются до float, и относительная погрешность релевантности порядка 1e-7
+    void CompressPostings();
+
+    size_t GetPostingMemoryUsage() const;
+
+    std::map<std::string_view, double> GetWordFrequencies(int document_id) const;
+
+    const std::map<TermId, double>& GetTermFrequencies(int document_id) const;
+
+    // слова документа без стоп-слов, как их видит AddDocument; ссылаются на text,
+    // при управляющих символах выбрасывается std::invalid_argument
+    std::vector<std::string_view> SplitIntoWordsNoStop(std::string_view text) const;
+
+private:
+    const StopWordSet stop_words_;
+    TermDictionary terms_;
+    // индексируется TermId
+    std::vector<PostingList> term_postings_;
+    bool compress_postings_ = false;
+    uint64_t generation_ = 0;
+
+    // внешний id -> внутренний номер документа
+    std::map<int, DocumentOrdinal> document_ordinals_;
+    // данные документов хранятся по столбцам и индексируются DocumentOrdinal;
+    // удалённый документ сначала только отмечается в removed_; когда удалённых номеров становится
+    // достаточно много, CompactOrdinals перенумеровывает живые документы подряд
+    std::vector<int> ordinal_to_id_;
+    std::vector<DocumentStatus> statuses_;
+    std::vector<int> ratings_;
+    std::vector<std::map<TermId, double>> ordinal_term_freqs_;
+    std::vector<bool> removed_;
+    LiveOrdinalIndex live_ordinals_;
+
+    DuplicatePolicy duplicate_policy_ = DuplicatePolicy::ALLOW;
+    // пуст, пока дубликаты не отслеживаются; один отпечаток может быть у нескольких документов:
+    // у одинаковых, проиндексированных до включения политики, и у разных при совпадении хешей
+    std::unordered_multimap<DocumentFingerprint, DocumentOrdinal, DocumentFingerprintHasher> fingerprint_ordinals_;
+    std::map<int, int> document_aliases_;
+    // id оригинала -> id его псевдонимов
+    std::multimap<int, int> original_aliases_;
+    std::vector<DuplicateDocument> duplicate_report_;
+
+    // log_counts_[k] = log(k); таблица растёт вместе с числом документов, и IDF
+    // вычисляется разностью двух значений из неё без вызова log() на запрос
+    std::vector<double> log_counts_ = { 0.0 };
+
+    // дописывает log_counts_ до числа выданных внутренних номеров
+    void ExtendLogCounts();
+
+    // заводит списки вхождений для новых термов словаря
+    void ExtendPostings();
+
+    // меньше стольких удалённых номеров не уплотняются, иначе почти пустой индекс уплотнялся бы после каждого удаления
+    static const size_t MIN_COMPACTED_ORDINALS = 1024;
+
+    // вызывается после удалений; уплотняет номера с сохранением порядка, если удалённых больше живых
+    // и больше MIN_COMPACTED_ORDINALS; время пропорционально числу номеров и вхождений живых документов
+    void CompactOrdinals();
+
+    bool IsStopWord(std::string_view word) const;
+
+    static bool IsValidWord(std::string_view word);
 
     static int ComputeAverageRating(const std::vector<int>& ratings);
 
+    bool IsDocumentIdUsed(int document_id) const;
+
+    // самый ранний проиндексированный документ с тем же набором слов
+    std::optional<DocumentOrdinal> FindSameDocument(const DocumentFingerprint& fingerprint, const std::map<TermId, double>& term_freqs) const;
+
+    // учитывает непроиндексированный дубликат по текущей политике
+    void RegisterDuplicate(int document_id, int original_id);
+
+    // убирает отпечаток и псевдонимы документа перед его удалением
+    void ForgetDuplicates(DocumentOrdinal ordinal);
+
+    void EraseAlias(int document_id);
+
+    template <typename ExecutionPolicy>
+    void AddDocuments(ExecutionPolicy policy, const std::vector<DocumentToAdd>& documents, size_t chunk_count);
+
     struct QueryWord {
-        std::string data;
+        std::string_view data;
         bool is_minus;
         bool is_stop;
     };
 
-    QueryWord ParseQueryWord(const std::string& text) const;
+    // управляющие символы здесь не проверяются: их находит TokenizeText в ParseQuery
+    QueryWord ParseQueryWord(std::string_view text) const;
 
+    // слова, которых нет в словаре, не встречаются ни в одном документе и в запрос не попадают
     struct Query {
-        std::set<std::string> plus_words;
-        std::set<std::string> minus_words;
+        std::vector<TermId> plus_terms;
+        std::vector<TermId> minus_terms;
     };
 
-    Query ParseQuery(const std::string& text) const;
+    // без сортировки и удаления повторов, если вызывающий сам разберётся с дубликатами
+    Query ParseQuery(std::string_view text, bool skip_sort = false) const;
+
+    double ComputeWordInverseDocumentFreq(TermId term_id) const;
+
+    // отмечает документы с минус-словами, чтобы не считать для них релевантность;
+    // пустой вектор, если минус-слов в запросе нет
+    std::vector<bool> BuildExclusionMask(const Query& query) const;
+
+    static const size_t RELEVANCE_BUCKET_COUNT = 101;
+
+    static bool IsMoreRelevant(const Document& lhs, const Document& rhs)
+    {
+        if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
+            return lhs.rating > rhs.rating;
+        }
+        else {
+            return lhs.relevance > rhs.relevance;
+        }
+    }
+
+    // возвращает не больше result_count лучших документов в произвольном порядке
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsMaxScore(const Query& query, DocumentPredicate document_predicate, size_t result_count) const;
 
-    double ComputeWordInverseDocumentFreq(const std::string& word) const;
+    template <typename DocumentPredicate>
+    std::vector<Document> FindAllDocuments(std::execution::sequenced_policy, const Query& query, DocumentPredicate document_predicate) const;
 
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const;
+    std::vector<Document> FindAllDocuments(std::execution::parallel_policy, const Query& query, DocumentPredicate document_predicate) const;
 };
 
 template <typename StringContainer>
@@ -140,55 +369,208 @@ SearchServer::SearchServer(const StringContainer& stop_words)
 }
 
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindTopDocuments(const std::string& raw_query, DocumentPredicate document_predicate) const {
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, SearchOptions options) const {
+    return FindTopDocuments(std::execution::seq, raw_query, document_predicate, options);
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentPredicate document_predicate,
+                                                     SearchOptions options) const {
     const auto query = ParseQuery(raw_query);
 
-    auto matched_documents = FindAllDocuments(query, document_predicate);
+    // отсечение MaxScore последовательно по своей природе и выполняется без учёта политики
+    auto matched_documents = options.engine == SearchEngine::MAX_SCORE
+        ? FindTopDocumentsMaxScore(query, document_predicate, options.limit > SIZE_MAX - options.offset ? SIZE_MAX : options.offset + options.limit)
+        : FindAllDocuments(policy, query, document_predicate);
+    if (options.offset >= matched_documents.size()) {
+        return {};
+    }
 
-    sort(matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs) {
-        if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
-            return lhs.rating > rhs.rating;
-        }
-        else {
-            return lhs.relevance > rhs.relevance;
+    // упорядочиваем только документы, попадающие в окно выдачи
+    const size_t window_end = options.offset + std::min(options.limit, matched_documents.size() - options.offset);
+    if (window_end < matched_documents.size()) {
+        std::partial_sort(policy, matched_documents.begin(), matched_documents.begin() + window_end, matched_documents.end(), IsMoreRelevant);
+        matched_documents.resize(window_end);
+    }
+    else {
+        std::sort(policy, matched_documents.begin(), matched_documents.end(), IsMoreRelevant);
+    }
+    matched_documents.erase(matched_documents.begin(), matched_documents.begin() + options.offset);
+
+    return matched_documents;
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentStatus status,
+                                                     SearchOptions options) const {
+    return FindTopDocuments(policy, raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
+        return document_status == status;
+    }, options);
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query) const {
+    return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindAllDocuments(std::execution::sequenced_policy, const Query& query, DocumentPredicate document_predicate) const {
+    const std::vector<bool> excluded = BuildExclusionMask(query);
+    std::map<DocumentOrdinal, double> document_to_relevance;
+    for (const TermId term_id : query.plus_terms) {
+        if (term_postings_[term_id].empty()) {
+            continue;
         }
+        const double inverse_document_freq = ComputeWordInverseDocumentFreq(term_id);
+        term_postings_[term_id].ForEach([&](DocumentOrdinal ordinal, double term_freq) {
+            if (removed_[ordinal] || (!excluded.empty() && excluded[ordinal])) {
+                return;
+            }
+            if (document_predicate(ordinal_to_id_[ordinal], statuses_[ordinal], ratings_[ordinal])) {
+                document_to_relevance[ordinal] += term_freq * inverse_document_freq;
+            }
         });
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
     }
 
+    std::vector<Document> matched_documents;
+    for (const auto [ordinal, relevance] : document_to_relevance) {
+        matched_documents.push_back({ ordinal_to_id_[ordinal], relevance, ratings_[ordinal] });
+    }
     return matched_documents;
 }
 
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const {
-    std::map<int, double> document_to_relevance;
-    for (const std::string& word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
+std::vector<Document> SearchServer::FindAllDocuments(std::execution::parallel_policy, const Query& query, DocumentPredicate document_predicate) const {
+    const std::vector<bool> excluded = BuildExclusionMask(query);
+    ConcurrentMap<DocumentOrdinal, double> document_to_relevance(RELEVANCE_BUCKET_COUNT);
+    std::for_each(std::execution::par, query.plus_terms.begin(), query.plus_terms.end(), [&](TermId term_id) {
+        if (term_postings_[term_id].empty()) {
+            return;
         }
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-        for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-            const auto& document_data = documents_.at(document_id);
-            if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                document_to_relevance[document_id] += term_freq * inverse_document_freq;
+        const double inverse_document_freq = ComputeWordInverseDocumentFreq(term_id);
+        term_postings_[term_id].ForEach(std::execution::par, [&](DocumentOrdinal ordinal, double term_freq) {
+            if (removed_[ordinal] || (!excluded.empty() && excluded[ordinal])) {
+                return;
+            }
+            if (document_predicate(ordinal_to_id_[ordinal], statuses_[ordinal], ratings_[ordinal])) {
+                document_to_relevance[ordinal].ref_to_value += term_freq * inverse_document_freq;
             }
+        });
+    });
+
+    std::vector<Document> matched_documents;
+    for (const auto [ordinal, relevance] : document_to_relevance.BuildOrdinaryMap()) {
+        matched_documents.push_back({ ordinal_to_id_[ordinal], relevance, ratings_[ordinal] });
+    }
+    return matched_documents;
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocumentsMaxScore(const Query& query, DocumentPredicate document_predicate, size_t result_count) const {
+    struct ScoredTerm {
+        PostingList::Cursor cursor;
+        double inverse_document_freq;
+        double max_score;
+    };
+
+    std::vector<ScoredTerm> terms;
+    for (const TermId term_id : query.plus_terms) {
+        const PostingList& postings = term_postings_[term_id];
+        if (postings.empty()) {
+            continue;
         }
+        const double inverse_document_freq = ComputeWordInverseDocumentFreq(term_id);
+        terms.push_back({ postings.GetCursor(), inverse_document_freq, postings.GetMaxTermFreq() * inverse_document_freq });
+    }
+    if (terms.empty() || result_count == 0) {
+        return {};
+    }
+
+    // max_score_prefix[i] - наибольший вклад, который дают термы [0, i] вместе
+    std::sort(terms.begin(), terms.end(), [](const ScoredTerm& lhs, const ScoredTerm& rhs) {
+        return lhs.max_score < rhs.max_score;
+    });
+    const std::vector<bool> excluded = BuildExclusionMask(query);
+    std::vector<double> max_score_prefix(terms.size());
+    double max_score_sum = 0.0;
+    for (size_t i = 0; i < terms.size(); ++i) {
+        max_score_sum += terms[i].max_score;
+        max_score_prefix[i] = max_score_sum;
     }
 
-    for (const std::string& word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
+    // на вершине кучи худший из отобранных документов
+    std::priority_queue<Document, std::vector<Document>, decltype(&IsMoreRelevant)> top_documents(IsMoreRelevant);
+    // документ с оценкой не выше порога точно не вытеснит худший отобранный
+    double threshold = -std::numeric_limits<double>::infinity();
+    // термы [0, first_essential) сами по себе не дают документу преодолеть порог
+    size_t first_essential = 0;
+
+    while (true) {
+        DocumentOrdinal candidate = std::numeric_limits<DocumentOrdinal>::max();
+        for (size_t i = first_essential; i < terms.size(); ++i) {
+            if (!terms[i].cursor.IsEnd()) {
+                candidate = std::min(candidate, terms[i].cursor.GetOrdinal());
+            }
+        }
+        if (candidate == std::numeric_limits<DocumentOrdinal>::max()) {
+            break;
+        }
+
+        double relevance = 0.0;
+        for (size_t i = first_essential; i < terms.size(); ++i) {
+            auto& cursor = terms[i].cursor;
+            if (!cursor.IsEnd() && cursor.GetOrdinal() == candidate) {
+                relevance += cursor.GetTermFreq() * terms[i].inverse_document_freq;
+                cursor.Next();
+            }
+        }
+
+        if (removed_[candidate] || (!excluded.empty() && excluded[candidate])
+            || !document_predicate(ordinal_to_id_[candidate], statuses_[candidate], ratings_[candidate])) {
+            continue;
+        }
+
+        bool pruned = false;
+        for (size_t i = first_essential; i-- > 0;) {
+            if (relevance + max_score_prefix[i] <= threshold) {
+                pruned = true;
+                break;
+            }
+            auto& cursor = terms[i].cursor;
+            cursor.SkipTo(candidate);
+            if (!cursor.IsEnd() && cursor.GetOrdinal() == candidate) {
+                relevance += cursor.GetTermFreq() * terms[i].inverse_document_freq;
+            }
+        }
+        if (pruned || relevance <= threshold) {
             continue;
         }
-        for (const auto [document_id, _] : word_to_document_freqs_.at(word)) 
-        {
-            document_to_relevance.erase(document_id);
+
+        const Document document(ordinal_to_id_[candidate], relevance, ratings_[candidate]);
+        if (top_documents.size() < result_count) {
+            top_documents.push(document);
+        }
+        else if (IsMoreRelevant(document, top_documents.top())) {
+            top_documents.pop();
+            top_documents.push(document);
+        }
+        else {
+            continue;
+        }
+
+        if (top_documents.size() == result_count) {
+            threshold = top_documents.top().relevance - EPSILON;
+            while (first_essential < terms.size() && max_score_prefix[first_essential] <= threshold) {
+                ++first_essential;
+            }
         }
     }
 
     std::vector<Document> matched_documents;
-    for (const auto [document_id, relevance] : document_to_relevance) {
-        matched_documents.push_back({ document_id, relevance, documents_.at(document_id).rating });
+    matched_documents.reserve(top_documents.size());
+    while (!top_documents.empty()) {
+        matched_documents.push_back(top_documents.top());
+        top_documents.pop();
     }
     return matched_documents;
 }
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+
+// формат снимка индекса: заголовок фиксированного размера, за ним данные; массивы в данных
+// выровнены на 8 байт от начала файла, поэтому читаются прямо из отображённой в память страницы
+const char SNAPSHOT_MAGIC[8] = { 'S', 'R', 'C', 'H', 'S', 'N', 'A', 'P' };
+// увеличивается при любом изменении раскладки данных
+const uint32_t SNAPSHOT_VERSION = 3;
+// записывается как есть: при чтении на машине с другим порядком байт значение не совпадёт
+const uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304;
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t payload_size;
+    // FNV-1a по всем байтам данных после заголовка
+    uint64_t checksum;
+};
+
+// пишет данные снимка в поток, на ходу считая размер и контрольную сумму
+class SnapshotWriter {
+public:
+    // поток должен быть открыт в двоичном режиме и поддерживать seekp
+    explicit SnapshotWriter(std::ostream& out);
+
+    template <typename T>
+    void Write(const T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values can be written");
+        WriteBytes(&value, sizeof(value));
+    }
+
+    template <typename T>
+    void WriteArray(const T* values, size_t count)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values can be written");
+        Align();
+        WriteBytes(values, count * sizeof(T));
+    }
+
+    void WriteString(std::string_view text);
+
+    // дописывает заголовок с итоговыми размером и контрольной суммой
+    void Finish();
+
+private:
+    std::ostream& out_;
+    uint64_t payload_size_ = 0;
+    uint64_t checksum_;
+
+    void WriteBytes(const void* data, size_t size);
+
+    void Align();
+};
+
+// читает данные снимка из памяти; конструктор проверяет заголовок и контрольную сумму,
+// при любой ошибке выбрасывается std::runtime_error
+class SnapshotReader {
+public:
+    SnapshotReader(const char* data, size_t size);
+
+    template <typename T>
+    T Read()
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values can be read");
+        T value;
+        std::memcpy(&value, Take(sizeof(T)), sizeof(T));
+        return value;
+    }
+
+    // указатель смотрит прямо в исходную память и действителен, пока она жива
+    template <typename T>
+    const T* ReadArray(size_t count)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values can be read");
+        Align();
+        if (count > (size_ - offset_) / sizeof(T))
+        {
+            throw std::runtime_error("Snapshot is truncated");
+        }
+        return reinterpret_cast<const T*>(Take(count * sizeof(T)));
+    }
+
+    std::string_view ReadString();
+
+    bool AtEnd() const
+    {
+        return offset_ == size_;
+    }
+
+private:
+    const char* data_;
+    size_t size_;
+    size_t offset_ = 0;
+
+    const char* Take(size_t size);
+
+    void Align();
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// неизменяемое множество стоп-слов: открытая адресация с линейным пробированием
+// в плоском массиве; поиск по string_view не выделяет память
+class StopWordSet {
+public:
+    StopWordSet() = default;
+
+    explicit StopWordSet(const std::set<std::string, std::less<>>& words);
+
+    bool Contains(std::string_view word) const;
+
+    // слова перечисляются по алфавиту
+    std::vector<std::string>::const_iterator begin() const
+    {
+        return words_.begin();
+    }
+
+    std::vector<std::string>::const_iterator end() const
+    {
+        return words_.end();
+    }
+
+    size_t size() const
+    {
+        return words_.size();
+    }
+
+private:
+    struct Slot {
+        // старшие биты хеша отсекают почти все несовпадения без сравнения строк
+        uint32_t hash_tag = 0;
+        // номер слова в words_, увеличенный на единицу; ноль означает пустую ячейку
+        uint32_t word_number = 0;
+    };
+
+    std::vector<std::string> words_;
+    // размер - степень двойки, заполнено не больше половины ячеек
+    std::vector<Slot> slots_;
+};
@@ -1,17 +1,31 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <set>
 
-std::vector<std::string> SplitIntoWords(const std::string& text);
+struct TokenizedText {
+    // слова ссылаются на исходный текст и действительны, пока он жив
+    std::vector<std::string_view> words;
+    // номер первого слова с управляющим символом [0, ' ') или words.size(), если таких нет
+    size_t first_invalid_word = 0;
+};
+
+// за один проход находит границы слов и управляющие символы;
+// на x86 блоки по 64 байта сканируются через AVX2 или SSE2, выбор делается при первом вызове
+TokenizedText TokenizeText(std::string_view text);
+
+std::vector<std::string_view> SplitIntoWords(std::string_view text);
+
+bool ContainsControlChars(std::string_view text);
 
 template <typename StringContainer>
-std::set<std::string> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
-    std::set<std::string> non_empty_strings;
-    for (const std::string& str : strings) {
+std::set<std::string, std::less<>> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
+    std::set<std::string, std::less<>> non_empty_strings;
+    for (const auto& str : strings) {
         if (!str.empty()) {
-            non_empty_strings.insert(str);
+            non_empty_strings.emplace(str);
         }
     }
     return non_empty_strings;
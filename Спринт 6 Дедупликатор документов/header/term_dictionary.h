@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using TermId = uint32_t;
+
+// словарь термов: каждое слово хранится один раз и получает плотный id
+class TermDictionary {
+public:
+    TermDictionary() = default;
+
+    // ключи word_to_id_ ссылаются на words_, поэтому при копировании индекс строится заново
+    TermDictionary(const TermDictionary& other);
+
+    TermDictionary& operator=(const TermDictionary& other);
+
+    // элементы deque при перемещении остаются на месте, и ключи остаются действительными
+    TermDictionary(TermDictionary&&) = default;
+
+    TermDictionary& operator=(TermDictionary&&) = default;
+
+    // возвращает id слова, добавляя его в словарь при первой встрече
+    TermId Intern(std::string_view word);
+
+    std::optional<TermId> Find(std::string_view word) const;
+
+    const std::string& GetWord(TermId term_id) const
+    {
+        return words_.at(term_id);
+    }
+
+    size_t size() const
+    {
+        return words_.size();
+    }
+
+private:
+    // индексируется TermId; deque не перемещает строки при добавлении
+    std::deque<std::string> words_;
+    std::map<std::string_view, TermId> word_to_id_;
+
+    void RebuildIndex();
+};
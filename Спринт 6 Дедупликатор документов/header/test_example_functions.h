@@ -1,3 +1,38 @@
 #pragma once
 
-void TestAddingDocument();
\ No newline at end of file
+void TestAddingDocument();
+
+void TestCopiedServerOutlivesOriginal();
+
+void TestMaxScoreMatchesExhaustive();
+
+void TestBulkAddMatchesSequential();
+
+void TestSnapshotRoundTrip();
+
+void TestCompressedPostingsMatchPlain();
+
+void TestRejectedDuplicatesLeaveServerUnchanged();
+
+void TestDuplicateAliasesResolveToOriginal();
+
+void TestNearDuplicateChainsAreSplit();
+
+void TestRemovalKeepsDocumentOrder();
+
+void TestProcessQueries();
+
+void TestPaginator();
+
+void TestFindDuplicatesExternal();
+
+void TestQueryExecutor();
+
+void TestRequestQueueCache();
+
+void TestConcurrentRequestQueueMatchesRequestQueue();
+
+void TestTokenizeTextMatchesByteLoop();
+
+// все тесты подряд; при ошибке программа завершается с сообщением
+void TestSearchServer();
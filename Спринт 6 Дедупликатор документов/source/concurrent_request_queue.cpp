@@ -0,0 +1,41 @@
+#include "concurrent_request_queue.h"
+
+using namespace std;
+
+vector<Document> ConcurrentRequestQueue::AddFindRequest(string_view raw_query, DocumentStatus status, SearchOptions options)
+{
+    const auto result = search_server_.FindTopDocuments(raw_query, status, options);
+    AddRequest(result.empty());
+    return result;
+}
+
+vector<Document> ConcurrentRequestQueue::AddFindRequest(string_view raw_query)
+{
+    const auto result = search_server_.FindTopDocuments(raw_query);
+    AddRequest(result.empty());
+    return result;
+}
+
+void ConcurrentRequestQueue::AddRequest(bool no_results)
+{
+    const uint64_t timestamp = current_time_.fetch_add(1, memory_order_relaxed) + 1;
+    const uint64_t record = (timestamp << 1) | (no_results ? 1 : 0);
+    atomic<uint64_t>& slot = requests_[timestamp % min_in_day_];
+
+    // поток мог задержаться так надолго, что ячейку уже занял запрос на сутки новее;
+    // тогда этот запрос из окна уже выпал и не учитывается
+    uint64_t previous = slot.load(memory_order_relaxed);
+    do
+    {
+        if ((previous >> 1) > timestamp)
+        {
+            return;
+        }
+    } while (!slot.compare_exchange_weak(previous, record, memory_order_relaxed));
+
+    const int delta = (no_results ? 1 : 0) - static_cast<int>(previous & 1);
+    if (delta != 0)
+    {
+        no_results_requests_.fetch_add(delta, memory_order_relaxed);
+    }
+}
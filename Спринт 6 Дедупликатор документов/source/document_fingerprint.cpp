@@ -0,0 +1,58 @@
+#include <algorithm>
+#include <functional>
+
+#include "document_fingerprint.h"
+
+namespace {
+
+const uint64_t HIGH_HALF_SEED = 0xC2B2AE3D27D4EB4Full;
+
+// FNV-1a: независим от std::hash
+uint64_t HashWord(std::string_view word)
+{
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (const char c : word)
+    {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+}
+
+uint64_t MixKey(uint64_t key)
+{
+    key += 0x9E3779B97F4A7C15ull;
+    key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ull;
+    key = (key ^ (key >> 27)) * 0x94D049BB133111EBull;
+    return key ^ (key >> 31);
+}
+
+void DocumentFingerprint::AddKey(uint64_t key)
+{
+    low += MixKey(key);
+    high += MixKey(key ^ HIGH_HALF_SEED);
+}
+
+void DocumentFingerprint::AddWord(std::string_view word)
+{
+    low += MixKey(std::hash<std::string_view>{}(word));
+    high += MixKey(HashWord(word));
+}
+
+DocumentFingerprint ComputeFingerprint(const std::map<TermId, double>& term_freqs)
+{
+    DocumentFingerprint fingerprint;
+    for (const auto& [term_id, _] : term_freqs)
+    {
+        fingerprint.AddKey(term_id);
+    }
+    return fingerprint;
+}
+
+bool HaveSameTerms(const std::map<TermId, double>& lhs, const std::map<TermId, double>& rhs)
+{
+    return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin(), [](const auto& lhs_term, const auto& rhs_term) {
+        return lhs_term.first == rhs_term.first;
+    });
+}
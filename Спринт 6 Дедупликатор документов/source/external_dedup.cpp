@@ -0,0 +1,241 @@
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <memory>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <string>
+
+#include "document_fingerprint.h"
+#include "external_dedup.h"
+
+using namespace std;
+
+namespace {
+
+struct FingerprintRecord {
+    DocumentFingerprint fingerprint;
+    // номер документа во входе
+    uint64_t sequence;
+    int id;
+};
+
+bool operator<(const FingerprintRecord& lhs, const FingerprintRecord& rhs)
+{
+    return lhs.fingerprint < rhs.fingerprint || (lhs.fingerprint == rhs.fingerprint && lhs.sequence < rhs.sequence);
+}
+
+// безымянный временный файл удаляется при закрытии
+using TempFile = unique_ptr<FILE, int (*)(FILE*)>;
+
+TempFile CreateTempFile()
+{
+    TempFile file(tmpfile(), &fclose);
+    if (!file)
+    {
+        throw runtime_error("Cannot create temporary file"s);
+    }
+    return file;
+}
+
+void WriteRecords(FILE* file, const FingerprintRecord* records, size_t count)
+{
+    if (fwrite(records, sizeof(FingerprintRecord), count, file) != count)
+    {
+        throw runtime_error("Cannot write temporary file"s);
+    }
+}
+
+// читает серию по одной записи, буферизацию берёт на себя stdio
+class RunReader {
+public:
+    explicit RunReader(FILE* file)
+        : file_(file)
+    {
+        rewind(file_);
+        Advance();
+    }
+
+    bool IsEnd() const
+    {
+        return is_end_;
+    }
+
+    const FingerprintRecord& Get() const
+    {
+        return record_;
+    }
+
+    void Advance()
+    {
+        is_end_ = fread(&record_, sizeof(record_), 1, file_) != 1;
+        if (is_end_ && ferror(file_))
+        {
+            throw runtime_error("Cannot read temporary file"s);
+        }
+    }
+
+private:
+    FILE* file_;
+    FingerprintRecord record_;
+    bool is_end_ = false;
+};
+
+// передаёт записи отсортированных серий в callback по возрастанию
+template <typename Callback>
+void MergeRuns(vector<TempFile>::const_iterator begin, vector<TempFile>::const_iterator end, Callback callback)
+{
+    vector<RunReader> readers;
+    for (auto it = begin; it != end; ++it)
+    {
+        readers.emplace_back(it->get());
+    }
+    const auto is_later = [&readers](size_t lhs, size_t rhs) {
+        return readers[rhs].Get() < readers[lhs].Get();
+    };
+    priority_queue<size_t, vector<size_t>, decltype(is_later)> heads(is_later);
+    for (size_t i = 0; i < readers.size(); ++i)
+    {
+        if (!readers[i].IsEnd())
+        {
+            heads.push(i);
+        }
+    }
+    while (!heads.empty())
+    {
+        const size_t i = heads.top();
+        heads.pop();
+        callback(readers[i].Get());
+        readers[i].Advance();
+        if (!readers[i].IsEnd())
+        {
+            heads.push(i);
+        }
+    }
+}
+
+}
+
+vector<int> FindDuplicatesExternal(istream& documents, const SearchServer& search_server, const ExternalDedupOptions& options)
+{
+    if (options.run_size == 0 || options.merge_fan_in < 2)
+    {
+        throw invalid_argument("Invalid external dedup options"s);
+    }
+
+    vector<TempFile> runs;
+    vector<FingerprintRecord> records;
+    records.reserve(options.run_size);
+    const auto flush_run = [&] {
+        sort(records.begin(), records.end());
+        runs.push_back(CreateTempFile());
+        WriteRecords(runs.back().get(), records.data(), records.size());
+        records.clear();
+    };
+
+    string line;
+    size_t line_number = 0;
+    uint64_t sequence = 0;
+    while (getline(documents, line))
+    {
+        ++line_number;
+        // выгрузки с концами строк CRLF
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+        const char* const line_end = line.data() + line.size();
+        const char* id_begin = line.data();
+        while (id_begin != line_end && *id_begin == ' ')
+        {
+            ++id_begin;
+        }
+        if (id_begin == line_end)
+        {
+            continue;
+        }
+        int id = 0;
+        const auto [id_end, error] = from_chars(id_begin, line_end, id);
+        if (error != errc() || id < 0 || (id_end != line_end && *id_end != ' '))
+        {
+            throw invalid_argument("Invalid document_id in line " + to_string(line_number));
+        }
+
+        vector<string_view> words;
+        try
+        {
+            words = search_server.SplitIntoWordsNoStop(string_view(id_end, line_end - id_end));
+        }
+        catch (const invalid_argument& e)
+        {
+            throw invalid_argument(e.what() + " in line "s + to_string(line_number));
+        }
+        sort(words.begin(), words.end());
+        words.erase(unique(words.begin(), words.end()), words.end());
+        DocumentFingerprint fingerprint;
+        for (const string_view word : words)
+        {
+            fingerprint.AddWord(word);
+        }
+
+        records.push_back({ fingerprint, sequence++, id });
+        if (records.size() == options.run_size)
+        {
+            flush_run();
+        }
+    }
+    if (documents.bad())
+    {
+        throw runtime_error("Cannot read documents"s);
+    }
+
+    // в группе записей с одним отпечатком первая по входу - оригинал, остальные - дубликаты
+    vector<pair<uint64_t, int>> duplicates;
+    optional<DocumentFingerprint> previous;
+    const auto collect = [&](const FingerprintRecord& record) {
+        if (previous == record.fingerprint)
+        {
+            duplicates.emplace_back(record.sequence, record.id);
+        }
+        previous = record.fingerprint;
+    };
+
+    if (runs.empty())
+    {
+        // весь вход поместился в одну серию, временные файлы не нужны
+        sort(records.begin(), records.end());
+        for_each(records.begin(), records.end(), collect);
+    }
+    else
+    {
+        if (!records.empty())
+        {
+            flush_run();
+        }
+        records.clear();
+        records.shrink_to_fit();
+        while (runs.size() > options.merge_fan_in)
+        {
+            vector<TempFile> merged_runs;
+            for (size_t begin = 0; begin < runs.size(); begin += options.merge_fan_in)
+            {
+                const size_t end = min(runs.size(), begin + options.merge_fan_in);
+                merged_runs.push_back(CreateTempFile());
+                FILE* merged = merged_runs.back().get();
+                MergeRuns(runs.begin() + begin, runs.begin() + end, [merged](const FingerprintRecord& record) {
+                    WriteRecords(merged, &record, 1);
+                });
+            }
+            runs = move(merged_runs);
+        }
+        MergeRuns(runs.begin(), runs.end(), collect);
+    }
+
+    sort(duplicates.begin(), duplicates.end());
+    vector<int> duplicate_ids(duplicates.size());
+    transform(duplicates.begin(), duplicates.end(), duplicate_ids.begin(), [](const pair<uint64_t, int>& duplicate) {
+        return duplicate.second;
+    });
+    return duplicate_ids;
+}
@@ -0,0 +1,65 @@
+#include "live_ordinal_index.h"
+
+namespace {
+
+size_t LowestBit(size_t value)
+{
+    return value & (~value + 1);
+}
+
+}
+
+void LiveOrdinalIndex::Reset(size_t count)
+{
+    tree_.assign(count + 1, 0);
+    for (size_t i = 1; i <= count; ++i)
+    {
+        tree_[i] = static_cast<uint32_t>(LowestBit(i));
+    }
+}
+
+void LiveOrdinalIndex::Append()
+{
+    const size_t position = tree_.size();
+    tree_.push_back(1 + CountPrefix(position - 1) - CountPrefix(position - LowestBit(position)));
+}
+
+void LiveOrdinalIndex::Erase(DocumentOrdinal ordinal)
+{
+    for (size_t i = ordinal + 1; i < tree_.size(); i += LowestBit(i))
+    {
+        --tree_[i];
+    }
+}
+
+DocumentOrdinal LiveOrdinalIndex::Select(size_t rank) const
+{
+    size_t step = 1;
+    while (step * 2 < tree_.size())
+    {
+        step *= 2;
+    }
+
+    // спуск по дереву: position - последняя позиция, до которой живых не больше rank
+    size_t position = 0;
+    size_t remaining = rank + 1;
+    for (; step > 0; step /= 2)
+    {
+        if (position + step < tree_.size() && tree_[position + step] < remaining)
+        {
+            position += step;
+            remaining -= tree_[position];
+        }
+    }
+    return static_cast<DocumentOrdinal>(position);
+}
+
+uint32_t LiveOrdinalIndex::CountPrefix(size_t count) const
+{
+    uint32_t result = 0;
+    for (size_t i = count; i > 0; i -= LowestBit(i))
+    {
+        result += tree_[i];
+    }
+    return result;
+}
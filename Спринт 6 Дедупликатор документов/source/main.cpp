@@ -5,6 +5,7 @@
 #include "paginator.h"
 #include "request_queue.h"
 #include "remove_duplicates.h"
+#include "test_example_functions.h"
 
 void PrintDocument(const Document& document) {
     std::cout << "{ "
@@ -13,12 +14,12 @@ void PrintDocument(const Document& document) {
         << "rating = " << document.rating << " }" << std::endl;
 }
 
-void PrintMatchDocumentResult(int document_id, const std::vector<std::string>& words, DocumentStatus status) {
+void PrintMatchDocumentResult(int document_id, const std::vector<std::string_view>& words, DocumentStatus status) {
     std::cout << "{ "
         << "document_id = " << document_id << ", "
         << "status = " << static_cast<int>(status) << ", "
         << "words =";
-    for (const std::string& word : words) {
+    for (const std::string_view word : words) {
         std::cout << ' ' << word;
     }
     std::cout << "}" << std::endl;
@@ -49,10 +50,8 @@ void FindTopDocuments(const SearchServer& search_server, const std::string& raw_
 void MatchDocuments(const SearchServer& search_server, const std::string& query) {
     try {
         std::cout << "Матчинг документов по запросу: " << query << std::endl;
-        const int document_count = search_server.GetDocumentCount();
-        for (int index = 0; index < document_count; ++index) 
+        for (const int document_id : search_server)
         {
-            const int document_id = search_server.GetDocumentId(index);
             const auto [words, status] = search_server.MatchDocument(query, document_id);
             PrintMatchDocumentResult(document_id, words, status);
         }
@@ -65,6 +64,8 @@ void MatchDocuments(const SearchServer& search_server, const std::string& query)
 using namespace std;
 
 int main() {
+    TestSearchServer();
+
     SearchServer search_server("and with"s);
 
     AddDocument(search_server, 1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
@@ -0,0 +1,110 @@
+#include "mapped_file.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& path)
+{
+    file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE)
+    {
+        file_ = nullptr;
+        throw std::runtime_error("Cannot open file " + path);
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file_, &file_size))
+    {
+        CloseHandle(file_);
+        throw std::runtime_error("Cannot get size of file " + path);
+    }
+    size_ = static_cast<size_t>(file_size.QuadPart);
+    if (size_ == 0)
+    {
+        return;
+    }
+
+    mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping_ != nullptr)
+    {
+        data_ = static_cast<const char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+    }
+    if (data_ == nullptr)
+    {
+        if (mapping_ != nullptr)
+        {
+            CloseHandle(mapping_);
+        }
+        CloseHandle(file_);
+        throw std::runtime_error("Cannot map file " + path);
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (data_ != nullptr)
+    {
+        UnmapViewOfFile(data_);
+    }
+    if (mapping_ != nullptr)
+    {
+        CloseHandle(mapping_);
+    }
+    if (file_ != nullptr)
+    {
+        CloseHandle(file_);
+    }
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path)
+{
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Cannot open file " + path);
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0)
+    {
+        close(fd);
+        throw std::runtime_error("Cannot get size of file " + path);
+    }
+    size_ = static_cast<size_t>(file_stat.st_size);
+    if (size_ == 0)
+    {
+        close(fd);
+        return;
+    }
+
+    // после mmap дескриптор больше не нужен, отображение остаётся действительным
+    void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        throw std::runtime_error("Cannot map file " + path);
+    }
+    data_ = static_cast<const char*>(data);
+}
+
+MappedFile::~MappedFile()
+{
+    if (data_ != nullptr)
+    {
+        munmap(const_cast<char*>(data_), size_);
+    }
+}
+
+#endif
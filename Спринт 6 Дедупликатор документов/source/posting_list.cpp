@@ -0,0 +1,284 @@
+#include "posting_list.h"
+
+namespace {
+
+const size_t BITS_PER_WORD = 32;
+
+uint32_t CountSignificantBits(uint32_t value)
+{
+    uint32_t bits = 0;
+    while (value != 0)
+    {
+        ++bits;
+        value >>= 1;
+    }
+    return bits;
+}
+
+}
+
+PostingList::Cursor::Cursor(const PostingList& postings)
+    : postings_(&postings)
+{
+    EnterBlock(0);
+}
+
+void PostingList::Cursor::Next()
+{
+    if (++index_ == BLOCK_SIZE && IsInBlock())
+    {
+        EnterBlock(block_index_ + 1);
+    }
+}
+
+void PostingList::Cursor::SkipTo(DocumentOrdinal ordinal)
+{
+    const auto& blocks = postings_->blocks_;
+    if (IsInBlock() && blocks[block_index_].last_ordinal < ordinal)
+    {
+        size_t block_index = block_index_ + 1;
+        while (block_index < blocks.size() && blocks[block_index].last_ordinal < ordinal)
+        {
+            ++block_index;
+        }
+        EnterBlock(block_index);
+    }
+
+    if (IsInBlock())
+    {
+        index_ = std::lower_bound(decoded_.ordinals + index_, decoded_.ordinals + BLOCK_SIZE, ordinal) - decoded_.ordinals;
+    }
+    else
+    {
+        const auto& ordinals = postings_->ordinals_;
+        index_ = std::lower_bound(ordinals.begin() + index_, ordinals.end(), ordinal) - ordinals.begin();
+    }
+}
+
+void PostingList::Cursor::EnterBlock(size_t block_index)
+{
+    block_index_ = block_index;
+    index_ = 0;
+    if (IsInBlock())
+    {
+        postings_->DecodeBlock(block_index_, decoded_);
+    }
+}
+
+void PostingList::Add(DocumentOrdinal ordinal, double term_freq)
+{
+    max_term_freq_ = std::max(max_term_freq_, term_freq);
+    if ((ordinals_.empty() && blocks_.empty()) || GetLastOrdinal() < ordinal)
+    {
+        ordinals_.push_back(ordinal);
+        term_freqs_.push_back(term_freq);
+        if (compressed_ && ordinals_.size() == BLOCK_SIZE)
+        {
+            SealFullBlocks();
+        }
+        return;
+    }
+
+    // вставка в середину сжатого списка требует распаковки; документы нумеруются
+    // в порядке добавления, поэтому на практике сюда попадают только несжатые списки
+    Decompress();
+    const auto it = std::lower_bound(ordinals_.begin(), ordinals_.end(), ordinal);
+    const auto index = it - ordinals_.begin();
+    if (it != ordinals_.end() && *it == ordinal)
+    {
+        term_freqs_[index] += term_freq;
+        max_term_freq_ = std::max(max_term_freq_, term_freqs_[index]);
+    }
+    else
+    {
+        ordinals_.insert(it, ordinal);
+        term_freqs_.insert(term_freqs_.begin() + index, term_freq);
+    }
+    if (compressed_)
+    {
+        SealFullBlocks();
+    }
+}
+
+void PostingList::Assign(const DocumentOrdinal* ordinals, const double* term_freqs, size_t count)
+{
+    blocks_.clear();
+    packed_deltas_.clear();
+    block_term_freqs_.clear();
+    ordinals_.assign(ordinals, ordinals + count);
+    term_freqs_.assign(term_freqs, term_freqs + count);
+    max_term_freq_ = count == 0 ? 0.0 : *std::max_element(term_freqs_.begin(), term_freqs_.end());
+    removed_count_ = 0;
+    if (compressed_)
+    {
+        SealFullBlocks();
+    }
+}
+
+void PostingList::MarkRemoved(const std::vector<bool>& removed, size_t removed_count)
+{
+    removed_count_ += removed_count;
+    if (removed_count_ <= size())
+    {
+        return;
+    }
+
+    DropRemoved(removed, nullptr);
+}
+
+void PostingList::Renumber(const std::vector<bool>& removed, const std::vector<DocumentOrdinal>& new_ordinals)
+{
+    DropRemoved(removed, &new_ordinals);
+}
+
+void PostingList::Compress()
+{
+    compressed_ = true;
+    SealFullBlocks();
+    ordinals_.shrink_to_fit();
+    term_freqs_.shrink_to_fit();
+    blocks_.shrink_to_fit();
+    packed_deltas_.shrink_to_fit();
+    block_term_freqs_.shrink_to_fit();
+}
+
+size_t PostingList::GetMemoryUsage() const
+{
+    return sizeof(*this)
+        + ordinals_.capacity() * sizeof(DocumentOrdinal)
+        + term_freqs_.capacity() * sizeof(double)
+        + blocks_.capacity() * sizeof(Block)
+        + packed_deltas_.capacity() * sizeof(uint32_t)
+        + block_term_freqs_.capacity() * sizeof(float);
+}
+
+void PostingList::DecodeBlock(size_t block_index, DecodedBlock& decoded) const
+{
+    // разности хранятся уменьшенными на единицу, поэтому у блока подряд идущих номеров ширина нулевая
+    const Block& block = blocks_[block_index];
+    DocumentOrdinal ordinal = block.first_ordinal;
+    decoded.ordinals[0] = ordinal;
+    if (block.bit_width == 0)
+    {
+        // у блока подряд идущих номеров упакованных разностей нет
+        for (size_t i = 1; i < BLOCK_SIZE; ++i)
+        {
+            decoded.ordinals[i] = ++ordinal;
+        }
+    }
+    else
+    {
+        const uint32_t* words = packed_deltas_.data() + block.delta_offset;
+        const uint64_t mask = (uint64_t(1) << block.bit_width) - 1;
+        for (size_t i = 1; i < BLOCK_SIZE; ++i)
+        {
+            const size_t bit = (i - 1) * block.bit_width;
+            const size_t word = bit / BITS_PER_WORD;
+            const uint64_t window = words[word] | (uint64_t(words[word + 1]) << BITS_PER_WORD);
+            ordinal += static_cast<DocumentOrdinal>((window >> (bit % BITS_PER_WORD)) & mask) + 1;
+            decoded.ordinals[i] = ordinal;
+        }
+    }
+
+    const float* term_freqs = block_term_freqs_.data() + block_index * BLOCK_SIZE;
+    for (size_t i = 0; i < BLOCK_SIZE; ++i)
+    {
+        decoded.term_freqs[i] = term_freqs[i];
+    }
+}
+
+void PostingList::SealFullBlocks()
+{
+    const size_t sealed_count = ordinals_.size() / BLOCK_SIZE * BLOCK_SIZE;
+    for (size_t begin = 0; begin < sealed_count; begin += BLOCK_SIZE)
+    {
+        uint32_t max_delta = 0;
+        for (size_t i = begin + 1; i < begin + BLOCK_SIZE; ++i)
+        {
+            max_delta = std::max(max_delta, ordinals_[i] - ordinals_[i - 1] - 1);
+        }
+
+        Block block;
+        block.first_ordinal = ordinals_[begin];
+        block.last_ordinal = ordinals_[begin + BLOCK_SIZE - 1];
+        block.delta_offset = static_cast<uint32_t>(packed_deltas_.size());
+        block.bit_width = CountSignificantBits(max_delta);
+
+        // лишнее слово в конце позволяет читать любую разность парой соседних слов;
+        // блоку подряд идущих номеров слова не нужны вовсе, DecodeBlock восстанавливает их по first_ordinal
+        const size_t word_count = block.bit_width == 0 ? 0 : ((BLOCK_SIZE - 1) * block.bit_width + BITS_PER_WORD - 1) / BITS_PER_WORD + 1;
+        packed_deltas_.resize(packed_deltas_.size() + word_count);
+        uint32_t* words = packed_deltas_.data() + block.delta_offset;
+        for (size_t i = 1; block.bit_width > 0 && i < BLOCK_SIZE; ++i)
+        {
+            const size_t bit = (i - 1) * block.bit_width;
+            const uint64_t value = uint64_t(ordinals_[begin + i] - ordinals_[begin + i - 1] - 1) << (bit % BITS_PER_WORD);
+            words[bit / BITS_PER_WORD] |= static_cast<uint32_t>(value);
+            words[bit / BITS_PER_WORD + 1] |= static_cast<uint32_t>(value >> BITS_PER_WORD);
+        }
+
+        for (size_t i = begin; i < begin + BLOCK_SIZE; ++i)
+        {
+            const float term_freq = static_cast<float>(term_freqs_[i]);
+            block_term_freqs_.push_back(term_freq);
+            max_term_freq_ = std::max(max_term_freq_, static_cast<double>(term_freq));
+        }
+        blocks_.push_back(block);
+    }
+
+    ordinals_.erase(ordinals_.begin(), ordinals_.begin() + sealed_count);
+    term_freqs_.erase(term_freqs_.begin(), term_freqs_.begin() + sealed_count);
+}
+
+void PostingList::Decompress()
+{
+    if (blocks_.empty())
+    {
+        return;
+    }
+
+    std::vector<DocumentOrdinal> ordinals;
+    std::vector<double> term_freqs;
+    ordinals.reserve(blocks_.size() * BLOCK_SIZE + ordinals_.size());
+    term_freqs.reserve(ordinals.capacity());
+    DecodedBlock decoded;
+    for (size_t block_index = 0; block_index < blocks_.size(); ++block_index)
+    {
+        DecodeBlock(block_index, decoded);
+        ordinals.insert(ordinals.end(), decoded.ordinals, decoded.ordinals + BLOCK_SIZE);
+        term_freqs.insert(term_freqs.end(), decoded.term_freqs, decoded.term_freqs + BLOCK_SIZE);
+    }
+    ordinals.insert(ordinals.end(), ordinals_.begin(), ordinals_.end());
+    term_freqs.insert(term_freqs.end(), term_freqs_.begin(), term_freqs_.end());
+
+    ordinals_ = std::move(ordinals);
+    term_freqs_ = std::move(term_freqs);
+    blocks_.clear();
+    packed_deltas_.clear();
+    block_term_freqs_.clear();
+}
+
+void PostingList::DropRemoved(const std::vector<bool>& removed, const std::vector<DocumentOrdinal>* new_ordinals)
+{
+    Decompress();
+    size_t kept = 0;
+    max_term_freq_ = 0.0;
+    for (size_t i = 0; i < ordinals_.size(); ++i)
+    {
+        if (removed[ordinals_[i]])
+        {
+            continue;
+        }
+        ordinals_[kept] = new_ordinals == nullptr ? ordinals_[i] : (*new_ordinals)[ordinals_[i]];
+        term_freqs_[kept] = term_freqs_[i];
+        max_term_freq_ = std::max(max_term_freq_, term_freqs_[kept]);
+        ++kept;
+    }
+    ordinals_.resize(kept);
+    term_freqs_.resize(kept);
+    removed_count_ = 0;
+    if (compressed_)
+    {
+        SealFullBlocks();
+    }
+}
@@ -0,0 +1,53 @@
+#include <algorithm>
+#include <exception>
+#include <execution>
+#include <numeric>
+
+#include "process_queries.h"
+
+using namespace std;
+
+namespace {
+
+// исключение из параллельного алгоритма завершило бы программу, поэтому ошибки
+// запоминаются и выбрасывается первая по порядку запросов
+template <typename Callback>
+void ForEachQuery(const vector<string>& queries, Callback callback)
+{
+    vector<size_t> indexes(queries.size());
+    iota(indexes.begin(), indexes.end(), 0);
+    vector<exception_ptr> errors(queries.size());
+    for_each(execution::par, indexes.begin(), indexes.end(), [&](size_t index) {
+        try
+        {
+            callback(index, queries[index]);
+        }
+        catch (...)
+        {
+            errors[index] = current_exception();
+        }
+    });
+    for (const exception_ptr& error : errors)
+    {
+        if (error)
+        {
+            rethrow_exception(error);
+        }
+    }
+}
+
+}
+
+vector<vector<Document>> ProcessQueries(const SearchServer& search_server, const vector<string>& queries)
+{
+    vector<vector<Document>> results(queries.size());
+    ForEachQuery(queries, [&](size_t index, const string& query) {
+        results[index] = search_server.FindTopDocuments(query);
+    });
+    return results;
+}
+
+JoinedDocuments ProcessQueriesJoined(const SearchServer& search_server, const vector<string>& queries)
+{
+    return JoinedDocuments(ProcessQueries(search_server, queries));
+}
@@ -0,0 +1,83 @@
+#include "query_executor.h"
+
+using namespace std;
+
+QueryExecutor::QueryExecutor(const SearchServer& search_server, size_t thread_count, size_t queue_capacity)
+    : search_server_(search_server)
+    , queue_capacity_(max<size_t>(1, queue_capacity))
+{
+    thread_count = max<size_t>(1, thread_count);
+    workers_.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i)
+    {
+        workers_.emplace_back([this] {
+            RunWorker();
+        });
+    }
+}
+
+QueryExecutor::~QueryExecutor()
+{
+    {
+        lock_guard guard(mutex_);
+        stopping_ = true;
+    }
+    has_tasks_.notify_all();
+    for (thread& worker : workers_)
+    {
+        worker.join();
+    }
+}
+
+future<vector<Document>> QueryExecutor::SubmitFindTopDocuments(string raw_query, Clock::time_point deadline)
+{
+    return SubmitFindTopDocuments(move(raw_query), DocumentStatus::ACTUAL, deadline);
+}
+
+future<vector<Document>> QueryExecutor::SubmitFindTopDocuments(string raw_query, DocumentStatus status, Clock::time_point deadline)
+{
+    return Submit([this, raw_query = move(raw_query), status] {
+        return search_server_.FindTopDocuments(raw_query, status);
+    }, deadline);
+}
+
+future<SearchServer::MatchedWords> QueryExecutor::SubmitMatchDocument(string raw_query, int document_id, Clock::time_point deadline)
+{
+    return Submit([this, raw_query = move(raw_query), document_id] {
+        return search_server_.MatchDocument(raw_query, document_id);
+    }, deadline);
+}
+
+void QueryExecutor::Enqueue(PendingTask task)
+{
+    {
+        unique_lock lock(mutex_);
+        has_space_.wait(lock, [this] {
+            return tasks_.size() < queue_capacity_;
+        });
+        tasks_.push_back(move(task));
+    }
+    has_tasks_.notify_one();
+}
+
+void QueryExecutor::RunWorker()
+{
+    while (true)
+    {
+        PendingTask task;
+        {
+            unique_lock lock(mutex_);
+            has_tasks_.wait(lock, [this] {
+                return stopping_ || !tasks_.empty();
+            });
+            if (tasks_.empty())
+            {
+                return;
+            }
+            task = move(tasks_.front());
+            tasks_.pop_front();
+        }
+        has_space_.notify_one();
+        task.run(Clock::now() > task.deadline);
+    }
+}
@@ -1,36 +1,191 @@
-#include <set>
+#include <algorithm>
+#include <execution>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <unordered_map>
 #include <vector>
 
+#include "document_fingerprint.h"
 #include "remove_duplicates.h"
 
 using namespace std;
 
+namespace {
+
+double ComputeJaccard(const map<TermId, double>& lhs, const map<TermId, double>& rhs)
+{
+    if (lhs.empty() && rhs.empty())
+    {
+        return 1.0;
+    }
+    size_t common = 0;
+    auto lhs_it = lhs.begin();
+    auto rhs_it = rhs.begin();
+    while (lhs_it != lhs.end() && rhs_it != rhs.end())
+    {
+        if (lhs_it->first < rhs_it->first)
+        {
+            ++lhs_it;
+        }
+        else if (rhs_it->first < lhs_it->first)
+        {
+            ++rhs_it;
+        }
+        else
+        {
+            ++common;
+            ++lhs_it;
+            ++rhs_it;
+        }
+    }
+    return static_cast<double>(common) / static_cast<double>(lhs.size() + rhs.size() - common);
+}
+
+}
+
 void RemoveDuplicates(SearchServer& search_server) 
 {
+    const vector<int> document_ids(search_server.begin(), search_server.end());
+    vector<DocumentFingerprint> fingerprints(document_ids.size());
+    transform(execution::par, document_ids.begin(), document_ids.end(), fingerprints.begin(), [&search_server](int document_id) {
+        return ComputeFingerprint(search_server.GetTermFrequencies(document_id));
+    });
+
+    // совпавшие отпечатки перепроверяются сравнением наборов слов, так что коллизия не удалит лишний документ
+    unordered_map<DocumentFingerprint, vector<int>, DocumentFingerprintHasher> originals;
+    originals.reserve(document_ids.size());
     vector<int> duplicates_id;
+    for (size_t i = 0; i < document_ids.size(); ++i) 
+    {
+        const map<TermId, double>& term_freqs = search_server.GetTermFrequencies(document_ids[i]);
+        vector<int>& same_fingerprint = originals[fingerprints[i]];
+        const bool is_duplicate = any_of(same_fingerprint.begin(), same_fingerprint.end(), [&](int original_id) {
+            return HaveSameTerms(search_server.GetTermFrequencies(original_id), term_freqs);
+        });
+        if (is_duplicate) 
+        {
+            duplicates_id.push_back(document_ids[i]);
+        }
+        else 
+        {
+            same_fingerprint.push_back(document_ids[i]);
+        }
+    }
+    for (auto doc_id_ : duplicates_id) 
+    {
+        cout << "Found duplicates document id " << doc_id_ << endl;
+    }
+    search_server.RemoveDocuments(duplicates_id);
+}
 
-    map<string, int> words_to_id_;
-    for (const int document_id : search_server) 
+vector<vector<int>> FindNearDuplicates(const SearchServer& search_server, const NearDuplicateOptions& options)
+{
+    if (!(options.jaccard_threshold > 0.0 && options.jaccard_threshold <= 1.0) || options.band_count == 0 || options.rows_per_band == 0)
     {
-        string document_words;
-        map<string, double> words_freq = search_server.GetWordFrequencies(document_id);
+        throw invalid_argument("Invalid near duplicate options"s);
+    }
 
-        for (const auto uniq_words : words_freq) 
+    const vector<int> document_ids(search_server.begin(), search_server.end());
+    const size_t signature_size = options.band_count * options.rows_per_band;
+    vector<uint64_t> signatures(document_ids.size() * signature_size, numeric_limits<uint64_t>::max());
+    vector<size_t> indexes(document_ids.size());
+    iota(indexes.begin(), indexes.end(), 0);
+    for_each(execution::par, indexes.begin(), indexes.end(), [&](size_t index) {
+        uint64_t* signature = signatures.data() + index * signature_size;
+        for (const auto& [term_id, _] : search_server.GetTermFrequencies(document_ids[index]))
         {
-            document_words += uniq_words.first;
+            const uint64_t term_hash = MixKey(term_id);
+            for (size_t k = 0; k < signature_size; ++k)
+            {
+                signature[k] = min(signature[k], MixKey(term_hash + k));
+            }
         }
-        if (words_to_id_.count(document_words) > 0) 
+    });
+
+    vector<uint64_t> band_hashes(document_ids.size() * options.band_count);
+    for_each(execution::par, indexes.begin(), indexes.end(), [&](size_t index) {
+        for (size_t band = 0; band < options.band_count; ++band)
         {
-            duplicates_id.push_back(document_id);
+            const uint64_t* rows = signatures.data() + index * signature_size + band * options.rows_per_band;
+            uint64_t band_hash = band;
+            for (size_t row = 0; row < options.rows_per_band; ++row)
+            {
+                band_hash = MixKey(band_hash ^ rows[row]);
+            }
+            band_hashes[index * options.band_count + band] = band_hash;
         }
-        else 
+    });
+
+    // документы перебираются в порядке добавления; документ присоединяется к самому раннему
+    // представителю, с которым его коэффициент не ниже порога, иначе сам становится представителем.
+    // так каждый член кластера близок именно к оставляемому документу, и цепочки мелких правок
+    // не склеивают далёкие документы. в корзинах хранятся только представители: совпадение полосы
+    // лишь делает их кандидатами, сходство проверяется по точному коэффициенту
+    vector<unordered_map<uint64_t, vector<size_t>>> band_representatives(options.band_count);
+    vector<size_t> representatives(document_ids.size());
+    vector<size_t> compared_with(document_ids.size(), numeric_limits<size_t>::max());
+    for (size_t index = 0; index < document_ids.size(); ++index)
+    {
+        const map<TermId, double>& term_freqs = search_server.GetTermFrequencies(document_ids[index]);
+        size_t representative = index;
+        for (size_t band = 0; band < options.band_count; ++band)
+        {
+            const auto bucket_it = band_representatives[band].find(band_hashes[index * options.band_count + band]);
+            if (bucket_it == band_representatives[band].end())
+            {
+                continue;
+            }
+            for (const size_t candidate : bucket_it->second)
+            {
+                // один и тот же представитель может встретиться в нескольких полосах
+                if (candidate >= representative || compared_with[candidate] == index)
+                {
+                    continue;
+                }
+                compared_with[candidate] = index;
+                if (ComputeJaccard(search_server.GetTermFrequencies(document_ids[candidate]), term_freqs) >= options.jaccard_threshold)
+                {
+                    representative = candidate;
+                }
+            }
+        }
+        representatives[index] = representative;
+        if (representative == index)
         {
-            words_to_id_[document_words] = document_id;
+            for (size_t band = 0; band < options.band_count; ++band)
+            {
+                band_representatives[band][band_hashes[index * options.band_count + band]].push_back(index);
+            }
         }
     }
-    for (auto doc_id_ : duplicates_id) 
+
+    vector<vector<int>> result;
+    vector<vector<int>> members(document_ids.size());
+    for (size_t index = 0; index < document_ids.size(); ++index)
     {
-        cout << "Found duplicates document id " << doc_id_ << endl;
-        search_server.RemoveDocument(doc_id_);
+        members[representatives[index]].push_back(document_ids[index]);
+    }
+    for (vector<int>& cluster : members)
+    {
+        if (cluster.size() > 1)
+        {
+            result.push_back(move(cluster));
+        }
+    }
+    return result;
+}
+
+void RemoveNearDuplicates(SearchServer& search_server, const NearDuplicateOptions& options)
+{
+    vector<int> duplicates_id;
+    for (const vector<int>& cluster : FindNearDuplicates(search_server, options))
+    {
+        duplicates_id.insert(duplicates_id.end(), cluster.begin() + 1, cluster.end());
+    }
+    for (auto doc_id_ : duplicates_id)
+    {
+        cout << "Found near duplicates document id " << doc_id_ << endl;
     }
+    search_server.RemoveDocuments(duplicates_id);
 }
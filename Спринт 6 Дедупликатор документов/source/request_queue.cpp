@@ -1,19 +1,19 @@
 #include "request_queue.h"
 
+#include <functional>
+
 using namespace std;
 
-vector<Document> RequestQueue::AddFindRequest(const string& raw_query, DocumentStatus status)
+vector<Document> RequestQueue::AddFindRequest(string_view raw_query, DocumentStatus status, SearchOptions options)
 {
-    const auto result = search_server_.FindTopDocuments(raw_query, status);
-    AddRequest(result.size());
-    return result;
+    return AddCachedRequest(raw_query, typeid(void), status, options, [&] {
+        return search_server_.FindTopDocuments(raw_query, status, options);
+    });
 }
 
-vector<Document> RequestQueue::AddFindRequest(const string& raw_query)
+vector<Document> RequestQueue::AddFindRequest(string_view raw_query)
 {
-    const auto result = search_server_.FindTopDocuments(raw_query);
-    AddRequest(result.size());
-    return result;
+    return AddFindRequest(raw_query, DocumentStatus::ACTUAL);
 }
 
 void RequestQueue::AddRequest(int results_num)
@@ -32,4 +32,75 @@ void RequestQueue::AddRequest(int results_num)
     if (0 == results_num) {
         ++no_results_requests_;
     }
-}
\ No newline at end of file
+}
+
+bool RequestQueue::CacheKey::operator==(const CacheKey& other) const
+{
+    return query == other.query && predicate_type == other.predicate_type && status == other.status
+        && offset == other.offset && limit == other.limit && engine == other.engine;
+}
+
+size_t RequestQueue::CacheKeyHasher::operator()(const CacheKey& key) const
+{
+    size_t hash = key.predicate_type.hash_code();
+    const auto combine = [&hash](size_t value) {
+        hash ^= value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+    };
+    for (const TermId term_id : key.query)
+    {
+        combine(term_id);
+    }
+    combine(static_cast<size_t>(key.status));
+    combine(key.offset);
+    combine(key.limit);
+    combine(static_cast<size_t>(key.engine));
+    return hash;
+}
+
+const vector<Document>* RequestQueue::FindInCache(const CacheKey& key)
+{
+    if (cache_generation_ != search_server_.GetGeneration())
+    {
+        cache_entries_.clear();
+        cache_index_.clear();
+        cache_generation_ = search_server_.GetGeneration();
+        cache_stats_.entries = 0;
+        cache_stats_.memory_usage = 0;
+    }
+
+    const auto it = cache_index_.find(key);
+    if (it == cache_index_.end())
+    {
+        ++cache_stats_.misses;
+        return nullptr;
+    }
+    ++cache_stats_.hits;
+    cache_entries_.splice(cache_entries_.begin(), cache_entries_, it->second);
+    return &it->second->documents;
+}
+
+void RequestQueue::PutInCache(CacheKey key, const vector<Document>& documents)
+{
+    if (cache_entries_.size() == cache_capacity_)
+    {
+        const CacheEntry& oldest = cache_entries_.back();
+        cache_stats_.memory_usage -= GetEntryMemoryUsage(oldest);
+        cache_index_.erase(oldest.key);
+        cache_entries_.pop_back();
+    }
+
+    cache_entries_.push_front({ move(key), documents });
+    cache_index_.emplace(cache_entries_.front().key, cache_entries_.begin());
+    cache_stats_.entries = cache_entries_.size();
+    cache_stats_.memory_usage += GetEntryMemoryUsage(cache_entries_.front());
+}
+
+size_t RequestQueue::GetEntryMemoryUsage(const CacheEntry& entry)
+{
+    // узел списка с записью, узел хеш-таблицы с копией ключа и динамические массивы обоих ключей и выдачи
+    const size_t list_node = sizeof(CacheEntry) + 2 * sizeof(void*);
+    const size_t index_node = sizeof(CacheKey) + sizeof(list<CacheEntry>::iterator) + 2 * sizeof(void*);
+    return list_node + index_node
+        + 2 * entry.key.query.capacity() * sizeof(TermId)
+        + entry.documents.capacity() * sizeof(Document);
+}
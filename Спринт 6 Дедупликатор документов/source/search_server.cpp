@@ -1,15 +1,24 @@
 #include <cmath>
+#include <fstream>
 #include <numeric>
+#include <set>
+#include <thread>
 
+#include "mapped_file.h"
 #include "search_server.h"
+#include "snapshot.h"
 
-SearchServer::SearchServer(const std::string& stop_words_text): SearchServer(SplitIntoWords(stop_words_text))
+SearchServer::SearchServer(const std::string& stop_words_text): SearchServer(std::string_view(stop_words_text))
 {
 }
 
-void SearchServer::AddDocument(int document_id, const std::string& document, DocumentStatus status, const std::vector<int>& ratings) 
+SearchServer::SearchServer(std::string_view stop_words_text): SearchServer(SplitIntoWords(stop_words_text))
 {
-    if ((document_id < 0) || (documents_.count(document_id) > 0)) 
+}
+
+void SearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) 
+{
+    if ((document_id < 0) || IsDocumentIdUsed(document_id)) 
     {
         throw std::invalid_argument("Invalid document_id");
     }
@@ -18,73 +27,648 @@ void SearchServer::AddDocument(int document_id, const std::string& document, Doc
 
     const double inv_word_count = 1.0 / words.size();
 
-    for (const std::string& word : words)
+    const auto ordinal = static_cast<DocumentOrdinal>(ordinal_to_id_.size());
+    std::map<TermId, double> term_freqs;
+    for (const std::string_view word : words)
     {
-        word_to_document_freqs_[word][document_id] += inv_word_count;
-        document_to_word_freqs_[document_id][word] += inv_word_count;
+        term_freqs[terms_.Intern(word)] += inv_word_count;
     }
+    if (duplicate_policy_ != DuplicatePolicy::ALLOW)
+    {
+        const DocumentFingerprint fingerprint = ComputeFingerprint(term_freqs);
+        if (const auto original = FindSameDocument(fingerprint, term_freqs))
+        {
+            RegisterDuplicate(document_id, ordinal_to_id_[*original]);
+            return;
+        }
+        fingerprint_ordinals_.emplace(fingerprint, ordinal);
+    }
+    ExtendPostings();
+    for (const auto [term_id, term_freq] : term_freqs)
+    {
+        term_postings_[term_id].Add(ordinal, term_freq);
+    }
+
+    document_ordinals_.emplace(document_id, ordinal);
+    ordinal_to_id_.push_back(document_id);
+    statuses_.push_back(status);
+    ratings_.push_back(ComputeAverageRating(ratings));
+    ordinal_term_freqs_.push_back(std::move(term_freqs));
+    removed_.push_back(false);
+    live_ordinals_.Append();
 
-    documents_.emplace(document_id, DocumentData{ ComputeAverageRating(ratings), status });
-    document_ids_.push_back(document_id);
+    ExtendLogCounts();
+    ++generation_;
+}
+
+void SearchServer::AddDocuments(const std::vector<DocumentToAdd>& documents)
+{
+    AddDocuments(std::execution::seq, documents);
+}
+
+void SearchServer::AddDocuments(std::execution::sequenced_policy, const std::vector<DocumentToAdd>& documents)
+{
+    AddDocuments(std::execution::seq, documents, 1);
+}
+
+void SearchServer::AddDocuments(std::execution::parallel_policy, const std::vector<DocumentToAdd>& documents)
+{
+    AddDocuments(std::execution::par, documents, std::max(1u, std::thread::hardware_concurrency()));
 }
 
-std::vector<Document> SearchServer::FindTopDocuments(const std::string& raw_query, DocumentStatus status) const 
+template <typename ExecutionPolicy>
+void SearchServer::AddDocuments(ExecutionPolicy policy, const std::vector<DocumentToAdd>& documents, size_t chunk_count)
 {
-    return FindTopDocuments(raw_query, [status](int document_id, DocumentStatus document_status, int rating) 
+    std::set<int> batch_ids;
+    for (const DocumentToAdd& document : documents)
     {
-        return document_status == status;
+        if ((document.id < 0) || IsDocumentIdUsed(document.id) || !batch_ids.insert(document.id).second)
+        {
+            throw std::invalid_argument("Invalid document_id");
+        }
+    }
+
+    // исключение из параллельного алгоритма завершило бы программу, поэтому ошибки
+    // разбора запоминаются и выбрасываются потом, для первого по порядку документа
+    std::vector<std::vector<std::string_view>> document_words(documents.size());
+    std::vector<std::string> errors(documents.size());
+    std::for_each(policy, documents.begin(), documents.end(), [&](const DocumentToAdd& document) {
+        const size_t index = &document - documents.data();
+        try
+        {
+            document_words[index] = SplitIntoWordsNoStop(document.text);
+        }
+        catch (const std::invalid_argument& e)
+        {
+            errors[index] = e.what();
+        }
+    });
+    for (const std::string& error : errors)
+    {
+        if (!error.empty())
+        {
+            throw std::invalid_argument(error);
+        }
+    }
+
+    // большинство слов уже есть в словаре и находится параллельно; новые слова получают
+    // по порядку те номера, которые им выдаст словарь, но попадают в него только после
+    // проверки пакета на дубликаты, чтобы отказ не оставил в словаре слов без списков вхождений
+    const TermId unknown_term = std::numeric_limits<TermId>::max();
+    std::vector<std::vector<TermId>> document_terms(documents.size());
+    std::transform(policy, document_words.begin(), document_words.end(), document_terms.begin(), [this, unknown_term](const std::vector<std::string_view>& words) {
+        std::vector<TermId> term_ids(words.size());
+        std::transform(words.begin(), words.end(), term_ids.begin(), [this, unknown_term](std::string_view word) {
+            return terms_.Find(word).value_or(unknown_term);
+        });
+        return term_ids;
     });
+    std::unordered_map<std::string_view, TermId> new_terms;
+    std::vector<std::string_view> new_words;
+    for (size_t i = 0; i < documents.size(); ++i)
+    {
+        for (size_t j = 0; j < document_terms[i].size(); ++j)
+        {
+            if (document_terms[i][j] == unknown_term)
+            {
+                const auto [new_term_it, inserted] = new_terms.emplace(document_words[i][j], static_cast<TermId>(terms_.size() + new_words.size()));
+                if (inserted)
+                {
+                    new_words.push_back(document_words[i][j]);
+                }
+                document_terms[i][j] = new_term_it->second;
+            }
+        }
+    }
+
+    // каждый кусок пакета строит свой частичный индекс: вхождения, упорядоченные по терму,
+    // а внутри терма по номеру документа
+    struct PostingEntry {
+        TermId term_id;
+        DocumentOrdinal ordinal;
+        double term_freq;
+    };
+    struct Chunk {
+        size_t begin;
+        size_t end;
+        std::vector<PostingEntry> entries;
+    };
+
+    std::vector<std::map<TermId, double>> document_term_freqs(documents.size());
+    std::transform(policy, document_terms.begin(), document_terms.end(), document_term_freqs.begin(), [](const std::vector<TermId>& term_ids) {
+        const double inv_word_count = 1.0 / term_ids.size();
+        std::map<TermId, double> term_freqs;
+        for (const TermId term_id : term_ids)
+        {
+            term_freqs[term_id] += inv_word_count;
+        }
+        return term_freqs;
+    });
+
+    // номера пакета, которые попадут в индекс; k-й из них получит номер first_ordinal + k
+    const auto first_ordinal = static_cast<DocumentOrdinal>(ordinal_to_id_.size());
+    std::vector<size_t> kept;
+    if (duplicate_policy_ == DuplicatePolicy::ALLOW)
+    {
+        kept.resize(documents.size());
+        std::iota(kept.begin(), kept.end(), 0);
+    }
+    else
+    {
+        std::vector<DocumentFingerprint> fingerprints(documents.size());
+        std::transform(policy, document_term_freqs.begin(), document_term_freqs.end(), fingerprints.begin(), [](const std::map<TermId, double>& term_freqs) {
+            return ComputeFingerprint(term_freqs);
+        });
+
+        // оригиналы из самого пакета попадают в общую таблицу только после проверки всего пакета,
+        // чтобы отказ с политикой REJECT не менял сервер
+        std::unordered_map<DocumentFingerprint, size_t, DocumentFingerprintHasher> batch_originals;
+        std::vector<DuplicateDocument> duplicates;
+        for (size_t i = 0; i < documents.size(); ++i)
+        {
+            if (const auto original = FindSameDocument(fingerprints[i], document_term_freqs[i]))
+            {
+                duplicates.push_back({ documents[i].id, ordinal_to_id_[*original] });
+                continue;
+            }
+            const auto [original_it, inserted] = batch_originals.emplace(fingerprints[i], i);
+            if (!inserted && HaveSameTerms(document_term_freqs[original_it->second], document_term_freqs[i]))
+            {
+                duplicates.push_back({ documents[i].id, documents[original_it->second].id });
+                continue;
+            }
+            kept.push_back(i);
+        }
+        if (duplicate_policy_ == DuplicatePolicy::REJECT && !duplicates.empty())
+        {
+            throw std::invalid_argument("Duplicate document");
+        }
+        for (const DuplicateDocument& duplicate : duplicates)
+        {
+            RegisterDuplicate(duplicate.id, duplicate.original_id);
+        }
+        for (size_t k = 0; k < kept.size(); ++k)
+        {
+            fingerprint_ordinals_.emplace(fingerprints[kept[k]], static_cast<DocumentOrdinal>(first_ordinal + k));
+        }
+    }
+
+    for (const std::string_view word : new_words)
+    {
+        terms_.Intern(word);
+    }
+
+    chunk_count = std::max<size_t>(1, std::min(chunk_count, kept.size()));
+    std::vector<Chunk> chunks(chunk_count);
+    for (size_t i = 0; i < chunk_count; ++i)
+    {
+        chunks[i].begin = kept.size() * i / chunk_count;
+        chunks[i].end = kept.size() * (i + 1) / chunk_count;
+    }
+
+    std::for_each(policy, chunks.begin(), chunks.end(), [&](Chunk& chunk) {
+        for (size_t k = chunk.begin; k < chunk.end; ++k)
+        {
+            for (const auto [term_id, term_freq] : document_term_freqs[kept[k]])
+            {
+                chunk.entries.push_back({ term_id, static_cast<DocumentOrdinal>(first_ordinal + k), term_freq });
+            }
+        }
+        std::stable_sort(chunk.entries.begin(), chunk.entries.end(), [](const PostingEntry& lhs, const PostingEntry& rhs) {
+            return lhs.term_id < rhs.term_id;
+        });
+    });
+
+    // слияние за один проход: термы разбиты на диапазоны, и каждый список вхождений
+    // дописывается одним потоком, куски берутся по порядку номеров документов
+    ExtendPostings();
+    std::vector<std::pair<TermId, TermId>> term_ranges(chunk_count);
+    for (size_t i = 0; i < chunk_count; ++i)
+    {
+        term_ranges[i] = { static_cast<TermId>(terms_.size() * i / chunk_count), static_cast<TermId>(terms_.size() * (i + 1) / chunk_count) };
+    }
+    std::for_each(policy, term_ranges.begin(), term_ranges.end(), [&](const std::pair<TermId, TermId>& term_range) {
+        for (const Chunk& chunk : chunks)
+        {
+            auto it = std::lower_bound(chunk.entries.begin(), chunk.entries.end(), term_range.first, [](const PostingEntry& entry, TermId term_id) {
+                return entry.term_id < term_id;
+            });
+            for (; it != chunk.entries.end() && it->term_id < term_range.second; ++it)
+            {
+                term_postings_[it->term_id].Add(it->ordinal, it->term_freq);
+            }
+        }
+    });
+
+    for (size_t k = 0; k < kept.size(); ++k)
+    {
+        const DocumentToAdd& document = documents[kept[k]];
+        document_ordinals_.emplace(document.id, static_cast<DocumentOrdinal>(first_ordinal + k));
+        ordinal_to_id_.push_back(document.id);
+        statuses_.push_back(document.status);
+        ratings_.push_back(ComputeAverageRating(document.ratings));
+        ordinal_term_freqs_.push_back(std::move(document_term_freqs[kept[k]]));
+        removed_.push_back(false);
+        live_ordinals_.Append();
+    }
+
+    ExtendLogCounts();
+    ++generation_;
 }
 
-std::vector<Document> SearchServer::FindTopDocuments(const std::string& raw_query) const {
-    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status, SearchOptions options) const 
+{
+    return FindTopDocuments(std::execution::seq, raw_query, status, options);
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query) const {
+    return FindTopDocuments(std::execution::seq, raw_query);
+}
+
+std::vector<TermId> SearchServer::NormalizeQuery(std::string_view raw_query) const {
+    const auto query = ParseQuery(raw_query);
+    std::vector<TermId> result;
+    result.reserve(query.plus_terms.size() + 1 + query.minus_terms.size());
+    result.insert(result.end(), query.plus_terms.begin(), query.plus_terms.end());
+    result.push_back(std::numeric_limits<TermId>::max());
+    result.insert(result.end(), query.minus_terms.begin(), query.minus_terms.end());
+    return result;
+}
+
+SearchServer::MatchedWords SearchServer::MatchDocument(std::string_view raw_query, int document_id) const {
+    return MatchDocument(std::execution::seq, raw_query, document_id);
 }
 
-std::tuple<std::vector<std::string>, DocumentStatus> SearchServer::MatchDocument(const std::string& raw_query, int document_id) const {
+SearchServer::MatchedWords SearchServer::MatchDocument(std::execution::sequenced_policy, std::string_view raw_query, int document_id) const {
     const auto query = ParseQuery(raw_query);
+    const DocumentOrdinal ordinal = document_ordinals_.at(ResolveDocumentId(document_id));
+    const auto& document_terms = ordinal_term_freqs_[ordinal];
+
+    for (const TermId term_id : query.minus_terms) {
+        if (document_terms.count(term_id) > 0) {
+            return { std::vector<std::string_view>(), statuses_[ordinal] };
+        }
+    }
+
+    std::vector<std::string_view> matched_words;
+    for (const TermId term_id : query.plus_terms) {
+        if (document_terms.count(term_id) > 0) {
+            matched_words.push_back(terms_.GetWord(term_id));
+        }
+    }
+    std::sort(matched_words.begin(), matched_words.end());
+    return { matched_words, statuses_[ordinal] };
+}
+
+SearchServer::MatchedWords SearchServer::MatchDocument(std::execution::parallel_policy, std::string_view raw_query, int document_id) const {
+    const auto query = ParseQuery(raw_query, true);
+    const DocumentOrdinal ordinal = document_ordinals_.at(ResolveDocumentId(document_id));
+    const auto& document_terms = ordinal_term_freqs_[ordinal];
+    const auto contains_term = [&document_terms](TermId term_id) {
+        return document_terms.count(term_id) > 0;
+    };
+
+    if (std::any_of(std::execution::par, query.minus_terms.begin(), query.minus_terms.end(), contains_term)) {
+        return { std::vector<std::string_view>(), statuses_[ordinal] };
+    }
+
+    std::vector<TermId> matched_terms(query.plus_terms.size());
+    matched_terms.erase(std::copy_if(std::execution::par, query.plus_terms.begin(), query.plus_terms.end(), matched_terms.begin(), contains_term),
+                        matched_terms.end());
+
+    std::vector<std::string_view> matched_words(matched_terms.size());
+    std::transform(std::execution::par, matched_terms.begin(), matched_terms.end(), matched_words.begin(), [this](TermId term_id) {
+        return std::string_view(terms_.GetWord(term_id));
+    });
+    std::sort(std::execution::par, matched_words.begin(), matched_words.end());
+    matched_words.erase(std::unique(matched_words.begin(), matched_words.end()), matched_words.end());
+    return { matched_words, statuses_[ordinal] };
+}
+
+int SearchServer::GetDocumentId(int index) const {
+    if (index < 0 || index >= GetDocumentCount()) {
+        throw std::out_of_range("Invalid document index");
+    }
+    return ordinal_to_id_[live_ordinals_.Select(index)];
+}
+
+void SearchServer::RemoveDocument(int document_id)
+{
+    RemoveDocument(std::execution::seq, document_id);
+}
+
+void SearchServer::RemoveDocument(std::execution::sequenced_policy, int document_id)
+{
+    const auto ordinal_it = document_ordinals_.find(document_id);
+    if (ordinal_it == document_ordinals_.end())
+    {
+        EraseAlias(document_id);
+        return;
+    }
+    const DocumentOrdinal ordinal = ordinal_it->second;
+    ForgetDuplicates(ordinal);
+    removed_[ordinal] = true;
+    live_ordinals_.Erase(ordinal);
+
+    for (const auto [term_id, _] : ordinal_term_freqs_[ordinal])
+    {
+        term_postings_[term_id].MarkRemoved(removed_);
+    }
 
-    std::vector<std::string> matched_words;
-    for (const std::string& word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
+    document_ordinals_.erase(ordinal_it);
+    ordinal_term_freqs_[ordinal].clear();
+    CompactOrdinals();
+    ++generation_;
+}
+
+void SearchServer::RemoveDocument(std::execution::parallel_policy, int document_id)
+{
+    const auto ordinal_it = document_ordinals_.find(document_id);
+    if (ordinal_it == document_ordinals_.end())
+    {
+        EraseAlias(document_id);
+        return;
+    }
+    const DocumentOrdinal ordinal = ordinal_it->second;
+    ForgetDuplicates(ordinal);
+    removed_[ordinal] = true;
+    live_ordinals_.Erase(ordinal);
+
+    // у каждого слова свой список вхождений, так что потоки не пересекаются
+    std::vector<TermId> term_ids;
+    term_ids.reserve(ordinal_term_freqs_[ordinal].size());
+    for (const auto [term_id, _] : ordinal_term_freqs_[ordinal])
+    {
+        term_ids.push_back(term_id);
+    }
+    std::for_each(std::execution::par, term_ids.begin(), term_ids.end(), [this](TermId term_id) {
+        term_postings_[term_id].MarkRemoved(removed_);
+    });
+
+    document_ordinals_.erase(ordinal_it);
+    ordinal_term_freqs_[ordinal].clear();
+    CompactOrdinals();
+    ++generation_;
+}
+
+void SearchServer::RemoveDocuments(const std::vector<int>& document_ids)
+{
+    // слова удаляемых документов с повторами; после сортировки длина серии - число удаляемых документов со словом
+    std::vector<TermId> removed_terms;
+    for (const int document_id : document_ids)
+    {
+        const auto ordinal_it = document_ordinals_.find(document_id);
+        if (ordinal_it == document_ordinals_.end())
+        {
+            EraseAlias(document_id);
             continue;
         }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
-            matched_words.push_back(word);
+        const DocumentOrdinal ordinal = ordinal_it->second;
+        ForgetDuplicates(ordinal);
+        removed_[ordinal] = true;
+        live_ordinals_.Erase(ordinal);
+        for (const auto [term_id, _] : ordinal_term_freqs_[ordinal])
+        {
+            removed_terms.push_back(term_id);
+        }
+        document_ordinals_.erase(ordinal_it);
+        ordinal_term_freqs_[ordinal].clear();
+    }
+
+    std::sort(removed_terms.begin(), removed_terms.end());
+    std::vector<std::pair<TermId, uint32_t>> removed_per_term;
+    for (const TermId term_id : removed_terms)
+    {
+        if (removed_per_term.empty() || removed_per_term.back().first != term_id)
+        {
+            removed_per_term.push_back({ term_id, 0 });
         }
+        ++removed_per_term.back().second;
     }
-    for (const std::string& word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
+    std::for_each(std::execution::par, removed_per_term.begin(), removed_per_term.end(), [this](const std::pair<TermId, uint32_t>& term_count) {
+        term_postings_[term_count.first].MarkRemoved(removed_, term_count.second);
+    });
+    CompactOrdinals();
+    ++generation_;
+}
+
+void SearchServer::CompactOrdinals()
+{
+    const size_t removed_count = ordinal_to_id_.size() - document_ordinals_.size();
+    if (removed_count <= document_ordinals_.size() || removed_count <= MIN_COMPACTED_ORDINALS)
+    {
+        return;
+    }
+
+    // список вхождений без живых документов уже пуст: MarkRemoved не оставляет в нём больше удалённых записей, чем живых,
+    // поэтому перенумеровываются только слова живых документов, и словарь не перебирается
+    std::vector<TermId> live_terms;
+    std::vector<DocumentOrdinal> new_ordinals(ordinal_to_id_.size());
+    DocumentOrdinal kept = 0;
+    for (DocumentOrdinal ordinal = 0; ordinal < ordinal_to_id_.size(); ++ordinal)
+    {
+        if (removed_[ordinal])
+        {
             continue;
         }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
-            matched_words.clear();
-            break;
+        for (const auto [term_id, _] : ordinal_term_freqs_[ordinal])
+        {
+            live_terms.push_back(term_id);
+        }
+        new_ordinals[ordinal] = kept;
+        ordinal_to_id_[kept] = ordinal_to_id_[ordinal];
+        statuses_[kept] = statuses_[ordinal];
+        ratings_[kept] = ratings_[ordinal];
+        ordinal_term_freqs_[kept] = std::move(ordinal_term_freqs_[ordinal]);
+        ++kept;
+    }
+
+    std::sort(live_terms.begin(), live_terms.end());
+    live_terms.erase(std::unique(live_terms.begin(), live_terms.end()), live_terms.end());
+    // у каждого слова свой список вхождений, так что потоки не пересекаются
+    std::for_each(std::execution::par, live_terms.begin(), live_terms.end(), [this, &new_ordinals](TermId term_id) {
+        term_postings_[term_id].Renumber(removed_, new_ordinals);
+    });
+
+    ordinal_to_id_.resize(kept);
+    statuses_.resize(kept);
+    ratings_.resize(kept);
+    ordinal_term_freqs_.resize(kept);
+    removed_.assign(kept, false);
+    live_ordinals_.Reset(kept);
+    for (auto& [_, ordinal] : document_ordinals_)
+    {
+        ordinal = new_ordinals[ordinal];
+    }
+    for (auto& [_, ordinal] : fingerprint_ordinals_)
+    {
+        ordinal = new_ordinals[ordinal];
+    }
+}
+
+void SearchServer::SetDuplicatePolicy(DuplicatePolicy policy)
+{
+    duplicate_policy_ = policy;
+    fingerprint_ordinals_.clear();
+    if (policy == DuplicatePolicy::ALLOW)
+    {
+        return;
+    }
+    // если одинаковые документы уже проиндексированы, отпечатки заводятся для всех: оригиналом считается
+    // самый ранний, а после его удаления - следующий
+    for (DocumentOrdinal ordinal = 0; ordinal < ordinal_to_id_.size(); ++ordinal)
+    {
+        if (!removed_[ordinal])
+        {
+            fingerprint_ordinals_.emplace(ComputeFingerprint(ordinal_term_freqs_[ordinal]), ordinal);
+        }
+    }
+}
+
+std::vector<DuplicateDocument> SearchServer::TakeDuplicateReport()
+{
+    std::vector<DuplicateDocument> report;
+    report.swap(duplicate_report_);
+    return report;
+}
+
+int SearchServer::ResolveDocumentId(int document_id) const
+{
+    const auto alias_it = document_aliases_.find(document_id);
+    return alias_it == document_aliases_.end() ? document_id : alias_it->second;
+}
+
+void SearchServer::CompressPostings()
+{
+    compress_postings_ = true;
+    ++generation_;
+    std::for_each(std::execution::par, term_postings_.begin(), term_postings_.end(), [](PostingList& postings) {
+        postings.Compress();
+    });
+}
+
+size_t SearchServer::GetPostingMemoryUsage() const
+{
+    size_t memory_usage = term_postings_.capacity() * sizeof(PostingList);
+    for (const PostingList& postings : term_postings_)
+    {
+        memory_usage += postings.GetMemoryUsage() - sizeof(PostingList);
+    }
+    return memory_usage;
+}
+
+bool SearchServer::IsDocumentIdUsed(int document_id) const
+{
+    return document_ordinals_.count(document_id) > 0 || document_aliases_.count(document_id) > 0;
+}
+
+std::optional<DocumentOrdinal> SearchServer::FindSameDocument(const DocumentFingerprint& fingerprint,
+                                                              const std::map<TermId, double>& term_freqs) const
+{
+    std::optional<DocumentOrdinal> original;
+    const auto [fingerprints_begin, fingerprints_end] = fingerprint_ordinals_.equal_range(fingerprint);
+    for (auto it = fingerprints_begin; it != fingerprints_end; ++it)
+    {
+        if ((!original || it->second < *original) && HaveSameTerms(ordinal_term_freqs_[it->second], term_freqs))
+        {
+            original = it->second;
         }
     }
-    return { matched_words, documents_.at(document_id).status };
+    return original;
 }
 
-bool SearchServer::IsStopWord(const std::string& word) const {
-    return stop_words_.count(word) > 0;
+void SearchServer::RegisterDuplicate(int document_id, int original_id)
+{
+    switch (duplicate_policy_)
+    {
+    case DuplicatePolicy::REJECT:
+        throw std::invalid_argument("Duplicate document");
+    case DuplicatePolicy::REPORT:
+        duplicate_report_.push_back({ document_id, original_id });
+        break;
+    case DuplicatePolicy::ALIAS:
+        document_aliases_.emplace(document_id, original_id);
+        original_aliases_.emplace(original_id, document_id);
+        break;
+    case DuplicatePolicy::ALLOW:
+        break;
+    }
 }
 
-bool SearchServer::IsValidWord(const std::string& word) {
-    return none_of(word.begin(), word.end(), [](char c) {
-        return c >= '\0' && c < ' ';
+void SearchServer::ForgetDuplicates(DocumentOrdinal ordinal)
+{
+    if (!fingerprint_ordinals_.empty())
+    {
+        const auto [fingerprints_begin, fingerprints_end] = fingerprint_ordinals_.equal_range(ComputeFingerprint(ordinal_term_freqs_[ordinal]));
+        const auto fingerprint_it = std::find_if(fingerprints_begin, fingerprints_end, [ordinal](const auto& fingerprint_ordinal) {
+            return fingerprint_ordinal.second == ordinal;
         });
+        if (fingerprint_it != fingerprints_end)
+        {
+            fingerprint_ordinals_.erase(fingerprint_it);
+        }
+    }
+
+    const auto [aliases_begin, aliases_end] = original_aliases_.equal_range(ordinal_to_id_[ordinal]);
+    for (auto it = aliases_begin; it != aliases_end; ++it)
+    {
+        document_aliases_.erase(it->second);
+    }
+    original_aliases_.erase(aliases_begin, aliases_end);
 }
 
-std::vector<std::string> SearchServer::SplitIntoWordsNoStop(const std::string& text) const {
-    std::vector<std::string> words;
-    for (const std::string& word : SplitIntoWords(text)) {
-        if (!IsValidWord(word)) {
-            throw std::invalid_argument("Word " + word + " is invalid");
-        }
-        if (!IsStopWord(word)) {
-            words.push_back(word);
+void SearchServer::EraseAlias(int document_id)
+{
+    const auto alias_it = document_aliases_.find(document_id);
+    if (alias_it == document_aliases_.end())
+    {
+        return;
+    }
+    auto [aliases_begin, aliases_end] = original_aliases_.equal_range(alias_it->second);
+    original_aliases_.erase(std::find_if(aliases_begin, aliases_end, [document_id](const auto& original_alias) {
+        return original_alias.second == document_id;
+    }));
+    document_aliases_.erase(alias_it);
+}
+
+void SearchServer::ExtendPostings()
+{
+    const size_t old_size = term_postings_.size();
+    term_postings_.resize(terms_.size());
+    if (compress_postings_)
+    {
+        for (size_t term_id = old_size; term_id < term_postings_.size(); ++term_id)
+        {
+            term_postings_[term_id].Compress();
         }
     }
-    return words;
+}
+
+void SearchServer::ExtendLogCounts()
+{
+    while (log_counts_.size() <= ordinal_to_id_.size())
+    {
+        log_counts_.push_back(log(static_cast<double>(log_counts_.size())));
+    }
+}
+
+bool SearchServer::IsStopWord(std::string_view word) const {
+    return stop_words_.Contains(word);
+}
+
+bool SearchServer::IsValidWord(std::string_view word) {
+    return !ContainsControlChars(word);
+}
+
+std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(std::string_view text) const {
+    TokenizedText tokens = TokenizeText(text);
+    if (tokens.first_invalid_word < tokens.words.size()) {
+        throw std::invalid_argument("Word " + std::string(tokens.words[tokens.first_invalid_word]) + " is invalid");
+    }
+    tokens.words.erase(std::remove_if(tokens.words.begin(), tokens.words.end(), [this](std::string_view word) {
+        return IsStopWord(word);
+    }), tokens.words.end());
+    return std::move(tokens.words);
 }
 
 
@@ -98,50 +682,278 @@ int SearchServer::ComputeAverageRating(const std::vector<int>& ratings)
     return std::accumulate(ratings.begin(), ratings.end(), 0) / static_cast<int>(ratings.size());
 }
 
-SearchServer::QueryWord SearchServer::ParseQueryWord(const std::string& text) const {
+SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view text) const {
     if (text.empty()) {
         throw std::invalid_argument("Query word is empty");
     }
-    std::string word = text;
+    std::string_view word = text;
     bool is_minus = false;
     if (word[0] == '-') {
         is_minus = true;
-        word = word.substr(1);
+        word.remove_prefix(1);
     }
-    if (word.empty() || word[0] == '-' || !IsValidWord(word)) {
-        throw std::invalid_argument("Query word " + text + " is invalid");
+    if (word.empty() || word[0] == '-') {
+        throw std::invalid_argument("Query word " + std::string(text) + " is invalid");
     }
 
     return { word, is_minus, IsStopWord(word) };
 }
 
-SearchServer::Query SearchServer::ParseQuery(const std::string& text) const {
+SearchServer::Query SearchServer::ParseQuery(std::string_view text, bool skip_sort) const {
     Query result;
-    for (const std::string& word : SplitIntoWords(text)) {
-        const auto query_word = ParseQueryWord(word);
-        if (!query_word.is_stop) {
-            if (query_word.is_minus) {
-                result.minus_words.insert(query_word.data);
+    const TokenizedText tokens = TokenizeText(text);
+    for (size_t i = 0; i < tokens.words.size(); ++i) {
+        const auto query_word = ParseQueryWord(tokens.words[i]);
+        if (i == tokens.first_invalid_word) {
+            throw std::invalid_argument("Query word " + std::string(tokens.words[i]) + " is invalid");
+        }
+        if (query_word.is_stop) {
+            continue;
+        }
+        const auto term_id = terms_.Find(query_word.data);
+        if (!term_id) {
+            continue;
+        }
+        if (query_word.is_minus) {
+            result.minus_terms.push_back(*term_id);
+        }
+        else {
+            result.plus_terms.push_back(*term_id);
+        }
+    }
+
+    if (skip_sort) {
+        return result;
+    }
+    for (auto* terms : { &result.plus_terms, &result.minus_terms }) {
+        std::sort(terms->begin(), terms->end());
+        terms->erase(std::unique(terms->begin(), terms->end()), terms->end());
+    }
+    return result;
+}
+
+double SearchServer::ComputeWordInverseDocumentFreq(TermId term_id) const {
+    return log_counts_[GetDocumentCount()] - log_counts_[term_postings_[term_id].size()];
+}
+
+std::vector<bool> SearchServer::BuildExclusionMask(const Query& query) const {
+    if (query.minus_terms.empty()) {
+        return {};
+    }
+    std::vector<bool> excluded(ordinal_to_id_.size());
+    for (const TermId term_id : query.minus_terms) {
+        term_postings_[term_id].ForEach([&excluded](DocumentOrdinal ordinal, double) {
+            excluded[ordinal] = true;
+        });
+    }
+    return excluded;
+}
+
+void SearchServer::SaveSnapshot(const std::string& path) const
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+        throw std::runtime_error("Cannot create snapshot " + path);
+    }
+    SnapshotWriter writer(out);
+
+    writer.Write(static_cast<uint64_t>(stop_words_.size()));
+    for (const std::string& stop_word : stop_words_)
+    {
+        writer.WriteString(stop_word);
+    }
+
+    writer.Write(static_cast<uint64_t>(terms_.size()));
+    for (TermId term_id = 0; term_id < terms_.size(); ++term_id)
+    {
+        writer.WriteString(terms_.GetWord(term_id));
+    }
+
+    std::vector<DocumentOrdinal> new_ordinals(ordinal_to_id_.size());
+    std::vector<int> ids;
+    std::vector<DocumentStatus> statuses;
+    std::vector<int> ratings;
+    for (DocumentOrdinal ordinal = 0; ordinal < ordinal_to_id_.size(); ++ordinal)
+    {
+        if (removed_[ordinal])
+        {
+            continue;
+        }
+        new_ordinals[ordinal] = static_cast<DocumentOrdinal>(ids.size());
+        ids.push_back(ordinal_to_id_[ordinal]);
+        statuses.push_back(statuses_[ordinal]);
+        ratings.push_back(ratings_[ordinal]);
+    }
+    writer.Write(static_cast<uint64_t>(ids.size()));
+    writer.WriteArray(ids.data(), ids.size());
+    writer.WriteArray(statuses.data(), statuses.size());
+    writer.WriteArray(ratings.data(), ratings.size());
+
+    std::vector<DocumentOrdinal> ordinals;
+    std::vector<double> term_freqs;
+    for (TermId term_id = 0; term_id < terms_.size(); ++term_id)
+    {
+        ordinals.clear();
+        term_freqs.clear();
+        term_postings_[term_id].ForEach([&](DocumentOrdinal ordinal, double term_freq) {
+            if (!removed_[ordinal])
+            {
+                ordinals.push_back(new_ordinals[ordinal]);
+                term_freqs.push_back(term_freq);
             }
-            else {
-                result.plus_words.insert(query_word.data);
+        });
+        writer.Write(static_cast<uint64_t>(ordinals.size()));
+        writer.WriteArray(ordinals.data(), ordinals.size());
+        writer.WriteArray(term_freqs.data(), term_freqs.size());
+    }
+
+    // отпечатки не сохраняются: при загрузке они строятся заново по политике
+    writer.Write(static_cast<uint32_t>(duplicate_policy_));
+    writer.Write(static_cast<uint32_t>(compress_postings_));
+    std::vector<int> aliases;
+    std::vector<int> alias_originals;
+    for (const auto [alias, original] : document_aliases_)
+    {
+        aliases.push_back(alias);
+        alias_originals.push_back(original);
+    }
+    writer.Write(static_cast<uint64_t>(aliases.size()));
+    writer.WriteArray(aliases.data(), aliases.size());
+    writer.WriteArray(alias_originals.data(), alias_originals.size());
+
+    writer.Finish();
+}
+
+SearchServer SearchServer::LoadSnapshot(const std::string& path)
+{
+    const MappedFile file(path);
+    SnapshotReader reader(file.data(), file.size());
+
+    std::vector<std::string_view> stop_words(reader.Read<uint64_t>());
+    for (std::string_view& stop_word : stop_words)
+    {
+        stop_word = reader.ReadString();
+    }
+    SearchServer server(stop_words);
+
+    const auto term_count = reader.Read<uint64_t>();
+    for (uint64_t term_id = 0; term_id < term_count; ++term_id)
+    {
+        if (server.terms_.Intern(reader.ReadString()) != term_id)
+        {
+            throw std::runtime_error("Snapshot contains repeated terms");
+        }
+    }
+
+    const auto document_count = reader.Read<uint64_t>();
+    const int* ids = reader.ReadArray<int>(document_count);
+    const DocumentStatus* statuses = reader.ReadArray<DocumentStatus>(document_count);
+    const int* ratings = reader.ReadArray<int>(document_count);
+    server.ordinal_to_id_.assign(ids, ids + document_count);
+    server.statuses_.assign(statuses, statuses + document_count);
+    server.ratings_.assign(ratings, ratings + document_count);
+    server.removed_.assign(document_count, false);
+    server.live_ordinals_.Reset(document_count);
+    for (DocumentOrdinal ordinal = 0; ordinal < document_count; ++ordinal)
+    {
+        if (ids[ordinal] < 0 || !server.document_ordinals_.emplace(ids[ordinal], ordinal).second)
+        {
+            throw std::runtime_error("Snapshot contains invalid document_id");
+        }
+    }
+
+    server.term_postings_.resize(term_count);
+    std::vector<size_t> document_term_counts(document_count + 1);
+    for (TermId term_id = 0; term_id < term_count; ++term_id)
+    {
+        const auto posting_count = reader.Read<uint64_t>();
+        const DocumentOrdinal* ordinals = reader.ReadArray<DocumentOrdinal>(posting_count);
+        const double* term_freqs = reader.ReadArray<double>(posting_count);
+        for (uint64_t i = 0; i < posting_count; ++i)
+        {
+            if (ordinals[i] >= document_count || (i > 0 && ordinals[i - 1] >= ordinals[i]))
+            {
+                throw std::runtime_error("Snapshot contains invalid posting list");
             }
+            ++document_term_counts[ordinals[i] + 1];
         }
+        server.term_postings_[term_id].Assign(ordinals, term_freqs, posting_count);
     }
-    return result;
+
+    // прямой индекс восстанавливается из списков вхождений: сначала они транспонируются
+    // в плоский массив, где термы каждого документа лежат подряд и по возрастанию,
+    // затем карта каждого документа строится из готового упорядоченного диапазона
+    std::partial_sum(document_term_counts.begin(), document_term_counts.end(), document_term_counts.begin());
+    std::vector<std::pair<TermId, double>> document_terms(document_term_counts.back());
+    std::vector<size_t> next_slot(document_term_counts.begin(), document_term_counts.end() - 1);
+    for (TermId term_id = 0; term_id < term_count; ++term_id)
+    {
+        server.term_postings_[term_id].ForEach([&](DocumentOrdinal ordinal, double term_freq) {
+            document_terms[next_slot[ordinal]++] = { term_id, term_freq };
+        });
+    }
+    server.ordinal_term_freqs_.reserve(document_count);
+    for (DocumentOrdinal ordinal = 0; ordinal < document_count; ++ordinal)
+    {
+        server.ordinal_term_freqs_.emplace_back(document_terms.begin() + document_term_counts[ordinal],
+                                                document_terms.begin() + document_term_counts[ordinal + 1]);
+    }
+
+    const auto duplicate_policy = reader.Read<uint32_t>();
+    if (duplicate_policy > static_cast<uint32_t>(DuplicatePolicy::ALIAS))
+    {
+        throw std::runtime_error("Snapshot contains invalid duplicate policy");
+    }
+    server.SetDuplicatePolicy(static_cast<DuplicatePolicy>(duplicate_policy));
+    const auto compress_postings = reader.Read<uint32_t>();
+    if (compress_postings > 1)
+    {
+        throw std::runtime_error("Snapshot contains invalid compression flag");
+    }
+    const auto alias_count = reader.Read<uint64_t>();
+    const int* aliases = reader.ReadArray<int>(alias_count);
+    const int* alias_originals = reader.ReadArray<int>(alias_count);
+    for (uint64_t i = 0; i < alias_count; ++i)
+    {
+        if (aliases[i] < 0 || server.IsDocumentIdUsed(aliases[i]) || server.document_ordinals_.count(alias_originals[i]) == 0)
+        {
+            throw std::runtime_error("Snapshot contains invalid document alias");
+        }
+        server.document_aliases_.emplace(aliases[i], alias_originals[i]);
+        server.original_aliases_.emplace(alias_originals[i], aliases[i]);
+    }
+    if (!reader.AtEnd())
+    {
+        throw std::runtime_error("Snapshot has trailing data");
+    }
+
+    server.ExtendLogCounts();
+    if (compress_postings == 1)
+    {
+        server.CompressPostings();
+    }
+    return server;
 }
 
-double SearchServer::ComputeWordInverseDocumentFreq(const std::string& word) const {
-    return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+std::map<std::string_view, double> SearchServer::GetWordFrequencies(int document_id) const
+{
+    std::map<std::string_view, double> word_freqs;
+    for (const auto [term_id, term_freq] : GetTermFrequencies(document_id))
+    {
+        word_freqs.emplace(terms_.GetWord(term_id), term_freq);
+    }
+    return word_freqs;
 }
 
-const std::map<std::string, double>& SearchServer::GetWordFrequencies(int document_id) const
+const std::map<TermId, double>& SearchServer::GetTermFrequencies(int document_id) const
 {
-    if (document_to_word_freqs_.count(document_id) <= 0)
+    const auto ordinal_it = document_ordinals_.find(ResolveDocumentId(document_id));
+    if (ordinal_it == document_ordinals_.end())
     {
-        static std::map<std::string, double> local_map_for_return;
+        static std::map<TermId, double> local_map_for_return;
         return local_map_for_return;
     }
 
-    return document_to_word_freqs_.at(document_id);
+    return ordinal_term_freqs_[ordinal_it->second];
 }
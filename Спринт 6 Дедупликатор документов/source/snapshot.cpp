@@ -0,0 +1,122 @@
+#include "snapshot.h"
+
+#include <string>
+
+namespace {
+
+const uint64_t CHECKSUM_OFFSET_BASIS = 14695981039346656037ull;
+const uint64_t CHECKSUM_PRIME = 1099511628211ull;
+const size_t SNAPSHOT_ALIGNMENT = 8;
+
+static_assert(sizeof(SnapshotHeader) % SNAPSHOT_ALIGNMENT == 0, "Payload must start aligned");
+
+uint64_t UpdateChecksum(uint64_t checksum, const char* data, size_t size)
+{
+    for (size_t i = 0; i < size; ++i)
+    {
+        checksum = (checksum ^ static_cast<unsigned char>(data[i])) * CHECKSUM_PRIME;
+    }
+    return checksum;
+}
+
+}
+
+SnapshotWriter::SnapshotWriter(std::ostream& out)
+    : out_(out)
+    , checksum_(CHECKSUM_OFFSET_BASIS)
+{
+    const SnapshotHeader header = {};
+    out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+void SnapshotWriter::WriteString(std::string_view text)
+{
+    Write(static_cast<uint32_t>(text.size()));
+    WriteBytes(text.data(), text.size());
+}
+
+void SnapshotWriter::Finish()
+{
+    SnapshotHeader header;
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.byte_order = SNAPSHOT_BYTE_ORDER;
+    header.payload_size = payload_size_;
+    header.checksum = checksum_;
+    out_.seekp(0);
+    out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out_.flush();
+    if (!out_)
+    {
+        throw std::runtime_error("Cannot write snapshot");
+    }
+}
+
+void SnapshotWriter::WriteBytes(const void* data, size_t size)
+{
+    const char* bytes = static_cast<const char*>(data);
+    out_.write(bytes, size);
+    checksum_ = UpdateChecksum(checksum_, bytes, size);
+    payload_size_ += size;
+}
+
+void SnapshotWriter::Align()
+{
+    static const char padding[SNAPSHOT_ALIGNMENT] = {};
+    WriteBytes(padding, (SNAPSHOT_ALIGNMENT - payload_size_ % SNAPSHOT_ALIGNMENT) % SNAPSHOT_ALIGNMENT);
+}
+
+SnapshotReader::SnapshotReader(const char* data, size_t size)
+{
+    SnapshotHeader header;
+    if (size < sizeof(header))
+    {
+        throw std::runtime_error("Snapshot is truncated");
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0)
+    {
+        throw std::runtime_error("File is not a search server snapshot");
+    }
+    if (header.byte_order != SNAPSHOT_BYTE_ORDER)
+    {
+        throw std::runtime_error("Snapshot was written with a different byte order");
+    }
+    if (header.version != SNAPSHOT_VERSION)
+    {
+        throw std::runtime_error("Unsupported snapshot version " + std::to_string(header.version));
+    }
+    if (header.payload_size != size - sizeof(header))
+    {
+        throw std::runtime_error("Snapshot is truncated");
+    }
+
+    data_ = data + sizeof(header);
+    size_ = static_cast<size_t>(header.payload_size);
+    if (UpdateChecksum(CHECKSUM_OFFSET_BASIS, data_, size_) != header.checksum)
+    {
+        throw std::runtime_error("Snapshot checksum mismatch");
+    }
+}
+
+std::string_view SnapshotReader::ReadString()
+{
+    const auto size = Read<uint32_t>();
+    return { Take(size), size };
+}
+
+const char* SnapshotReader::Take(size_t size)
+{
+    if (size > size_ - offset_)
+    {
+        throw std::runtime_error("Snapshot is truncated");
+    }
+    const char* result = data_ + offset_;
+    offset_ += size;
+    return result;
+}
+
+void SnapshotReader::Align()
+{
+    Take((SNAPSHOT_ALIGNMENT - offset_ % SNAPSHOT_ALIGNMENT) % SNAPSHOT_ALIGNMENT);
+}
@@ -0,0 +1,46 @@
+#include "stop_word_set.h"
+
+#include <functional>
+
+StopWordSet::StopWordSet(const std::set<std::string, std::less<>>& words)
+    : words_(words.begin(), words.end())
+{
+    size_t slot_count = 1;
+    while (slot_count < words_.size() * 2)
+    {
+        slot_count *= 2;
+    }
+    slots_.resize(slot_count);
+
+    const size_t mask = slot_count - 1;
+    for (size_t i = 0; i < words_.size(); ++i)
+    {
+        const uint64_t hash = std::hash<std::string_view>{}(words_[i]);
+        size_t slot = hash & mask;
+        while (slots_[slot].word_number != 0)
+        {
+            slot = (slot + 1) & mask;
+        }
+        slots_[slot] = { static_cast<uint32_t>(hash >> 32), static_cast<uint32_t>(i + 1) };
+    }
+}
+
+bool StopWordSet::Contains(std::string_view word) const
+{
+    if (words_.empty())
+    {
+        return false;
+    }
+
+    const uint64_t hash = std::hash<std::string_view>{}(word);
+    const auto hash_tag = static_cast<uint32_t>(hash >> 32);
+    const size_t mask = slots_.size() - 1;
+    for (size_t slot = hash & mask; slots_[slot].word_number != 0; slot = (slot + 1) & mask)
+    {
+        if (slots_[slot].hash_tag == hash_tag && words_[slots_[slot].word_number - 1] == word)
+        {
+            return true;
+        }
+    }
+    return false;
+}
@@ -1,22 +1,180 @@
 #include "string_processing.h"
 
-std::vector<std::string> SplitIntoWords(const std::string& text) {
-    std::vector<std::string> words;
-    std::string word;
-    for (const char c : text) {
-        if (c == ' ') {
-            if (!word.empty()) {
-                words.push_back(word);
-                word.clear();
+#include <algorithm>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define STRING_PROCESSING_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace {
+
+const size_t BLOCK_SIZE = 64;
+
+// бит i масок соответствует байту i блока
+struct BlockMasks {
+    uint64_t spaces = 0;
+    uint64_t controls = 0;
+};
+
+using BlockScanner = BlockMasks (*)(const char* data);
+
+int CountTrailingZeros(uint64_t mask) {
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return static_cast<int>(index);
+#elif defined(__GNUC__)
+    return __builtin_ctzll(mask);
+#else
+    int index = 0;
+    while ((mask & 1) == 0) {
+        mask >>= 1;
+        ++index;
+    }
+    return index;
+#endif
+}
+
+BlockMasks ScanBlockScalar(const char* data, size_t size) {
+    BlockMasks masks;
+    for (size_t i = 0; i < size; ++i) {
+        const auto c = static_cast<unsigned char>(data[i]);
+        masks.spaces |= static_cast<uint64_t>(c == ' ') << i;
+        masks.controls |= static_cast<uint64_t>(c < ' ') << i;
+    }
+    return masks;
+}
+
+#ifndef STRING_PROCESSING_X86
+BlockMasks ScanFullBlockScalar(const char* data) {
+    return ScanBlockScalar(data, BLOCK_SIZE);
+}
+#else
+BlockMasks ScanFullBlockSse2(const char* data) {
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i last_control = _mm_set1_epi8(' ' - 1);
+    BlockMasks masks;
+    for (size_t offset = 0; offset < BLOCK_SIZE; offset += 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset));
+        // беззнаковое сравнение byte <= 0x1F через min
+        const __m128i controls = _mm_cmpeq_epi8(_mm_min_epu8(bytes, last_control), bytes);
+        masks.spaces |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, space)))) << offset;
+        masks.controls |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(controls))) << offset;
+    }
+    return masks;
+}
+
+TARGET_AVX2 BlockMasks ScanFullBlockAvx2(const char* data) {
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i last_control = _mm256_set1_epi8(' ' - 1);
+    BlockMasks masks;
+    for (size_t offset = 0; offset < BLOCK_SIZE; offset += 32) {
+        const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + offset));
+        const __m256i controls = _mm256_cmpeq_epi8(_mm256_min_epu8(bytes, last_control), bytes);
+        masks.spaces |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, space)))) << offset;
+        masks.controls |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(controls))) << offset;
+    }
+    return masks;
+}
+
+bool CpuSupportsAvx2() {
+#ifdef _MSC_VER
+    int registers[4];
+    __cpuid(registers, 1);
+    const bool os_saves_ymm = (registers[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+    __cpuidex(registers, 7, 0);
+    return os_saves_ymm && (registers[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+BlockScanner ChooseBlockScanner() {
+#ifdef STRING_PROCESSING_X86
+    if (CpuSupportsAvx2()) {
+        return ScanFullBlockAvx2;
+    }
+    return ScanFullBlockSse2;
+#else
+    return ScanFullBlockScalar;
+#endif
+}
+
+BlockScanner GetBlockScanner() {
+    static const BlockScanner scanner = ChooseBlockScanner();
+    return scanner;
+}
+
+} // namespace
+
+TokenizedText TokenizeText(std::string_view text) {
+    TokenizedText result;
+    const BlockScanner scan_full_block = GetBlockScanner();
+
+    size_t first_control = text.npos;
+    size_t word_begin = 0;
+    bool previous_is_space = true;
+    for (size_t base = 0; base < text.size(); base += BLOCK_SIZE) {
+        const size_t size = std::min(BLOCK_SIZE, text.size() - base);
+        const BlockMasks masks = size == BLOCK_SIZE ? scan_full_block(text.data() + base) : ScanBlockScalar(text.data() + base, size);
+
+        // границы слов там, где пробельность байта отличается от предыдущего
+        const uint64_t in_block = size == BLOCK_SIZE ? ~uint64_t{ 0 } : (uint64_t{ 1 } << size) - 1;
+        uint64_t boundaries = (masks.spaces ^ ((masks.spaces << 1) | (previous_is_space ? 1 : 0))) & in_block;
+        while (boundaries != 0) {
+            const int position = CountTrailingZeros(boundaries);
+            boundaries &= boundaries - 1;
+            if ((masks.spaces >> position) & 1) {
+                result.words.push_back(text.substr(word_begin, base + position - word_begin));
+            }
+            else {
+                word_begin = base + position;
             }
         }
-        else {
-            word += c;
+        previous_is_space = (masks.spaces >> (size - 1)) & 1;
+
+        if (first_control == text.npos && masks.controls != 0) {
+            first_control = base + CountTrailingZeros(masks.controls);
         }
     }
-    if (!word.empty()) {
-        words.push_back(word);
+    if (!previous_is_space) {
+        result.words.push_back(text.substr(word_begin));
+    }
+
+    result.first_invalid_word = result.words.size();
+    if (first_control != text.npos) {
+        // управляющий символ не пробел, поэтому лежит внутри последнего слова, начатого до него
+        const char* control = text.data() + first_control;
+        const auto word_after = std::upper_bound(result.words.begin(), result.words.end(), control,
+            [](const char* position, std::string_view word) {
+                return position < word.data();
+            });
+        result.first_invalid_word = (word_after - result.words.begin()) - 1;
     }
 
-    return words;
+    return result;
+}
+
+std::vector<std::string_view> SplitIntoWords(std::string_view text) {
+    return TokenizeText(text).words;
+}
+
+bool ContainsControlChars(std::string_view text) {
+    const BlockScanner scan_full_block = GetBlockScanner();
+    size_t base = 0;
+    for (; base + BLOCK_SIZE <= text.size(); base += BLOCK_SIZE) {
+        if (scan_full_block(text.data() + base).controls != 0) {
+            return true;
+        }
+    }
+    return ScanBlockScalar(text.data() + base, text.size() - base).controls != 0;
 }
\ No newline at end of file
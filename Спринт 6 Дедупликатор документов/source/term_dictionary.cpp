@@ -0,0 +1,47 @@
+#include "term_dictionary.h"
+
+TermDictionary::TermDictionary(const TermDictionary& other)
+    : words_(other.words_)
+{
+    RebuildIndex();
+}
+
+TermDictionary& TermDictionary::operator=(const TermDictionary& other)
+{
+    if (this != &other)
+    {
+        words_ = other.words_;
+        RebuildIndex();
+    }
+    return *this;
+}
+
+TermId TermDictionary::Intern(std::string_view word)
+{
+    if (const auto it = word_to_id_.find(word); it != word_to_id_.end())
+    {
+        return it->second;
+    }
+
+    const std::string& stored_word = words_.emplace_back(word);
+    return word_to_id_.emplace(stored_word, static_cast<TermId>(words_.size() - 1)).first->second;
+}
+
+std::optional<TermId> TermDictionary::Find(std::string_view word) const
+{
+    const auto it = word_to_id_.find(word);
+    if (it == word_to_id_.end())
+    {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+void TermDictionary::RebuildIndex()
+{
+    word_to_id_.clear();
+    for (TermId term_id = 0; term_id < words_.size(); ++term_id)
+    {
+        word_to_id_.emplace(words_[term_id], term_id);
+    }
+}
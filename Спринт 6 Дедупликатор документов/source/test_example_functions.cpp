@@ -1,5 +1,27 @@
 ﻿#include "test_example_functions.h"
+#include "concurrent_request_queue.h"
+#include "external_dedup.h"
+#include "paginator.h"
+#include "process_queries.h"
+#include "query_executor.h"
+#include "remove_duplicates.h"
+#include "request_queue.h"
 #include "search_server.h"
+#include "string_processing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <forward_list>
+#include <future>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <sstream>
+#include <thread>
 
 void AssertImpl(bool value, const std::string& expr_str, const std::string& file, 
                 const std::string& func, unsigned line, const std::string& hint) 
@@ -31,4 +53,661 @@ void TestAddingDocument()
     ASSERT_HINT(found_docs.size() == 1, "Something wrong with adding document");
     ASSERT_HINT(found_docs.at(0).id == 42, "Something wrong with reading document_id");
     ASSERT_HINT(found_docs.at(0).rating == 2, "Something wrong with calculating average rating");
-}
\ No newline at end of file
+}
+
+void TestCopiedServerOutlivesOriginal()
+{
+    auto original = std::make_unique<SearchServer>(std::string("and"));
+    original->AddDocument(1, "fluffy cat and collar", DocumentStatus::ACTUAL, { 1 });
+    SearchServer copy = *original;
+    original.reset();
+
+    const auto [words, status] = copy.MatchDocument("cat fluffy", 1);
+    ASSERT_HINT(words == std::vector<std::string_view>({ "cat", "fluffy" }), "A copy must keep its own dictionary");
+    ASSERT_HINT(copy.GetWordFrequencies(1).count("collar") == 1, "A copy must keep its own dictionary");
+    copy.AddDocument(2, "collar dog", DocumentStatus::ACTUAL, { 2 });
+    ASSERT_HINT(copy.FindTopDocuments("collar dog").size() == 2, "A copy must accept new words");
+}
+
+void TestMaxScoreMatchesExhaustive()
+{
+    SearchServer search_server(std::string("and in"));
+    search_server.AddDocument(1, "white cat and fashion collar", DocumentStatus::ACTUAL, { 8, -3 });
+    search_server.AddDocument(2, "fluffy cat fluffy tail", DocumentStatus::ACTUAL, { 7, 2, 7 });
+    search_server.AddDocument(3, "groomed dog expressive eyes", DocumentStatus::ACTUAL, { 5, -12, 2, 1 });
+    search_server.AddDocument(4, "groomed starling eugene", DocumentStatus::BANNED, { 9 });
+    search_server.AddDocument(5, "cat in the city", DocumentStatus::ACTUAL, { 1, 2, 3 });
+
+    for (const std::string query : { "fluffy groomed cat", "cat -collar", "groomed eyes tail", "city cat dog" }) {
+        for (size_t limit = 1; limit <= 5; ++limit) {
+            const auto exhaustive = search_server.FindTopDocuments(query, DocumentStatus::ACTUAL, { 0, limit, SearchEngine::EXHAUSTIVE });
+            const auto max_score = search_server.FindTopDocuments(query, DocumentStatus::ACTUAL, { 0, limit, SearchEngine::MAX_SCORE });
+            ASSERT_HINT(exhaustive.size() == max_score.size(), "MaxScore must return as many documents as exhaustive search");
+            for (size_t i = 0; i < exhaustive.size(); ++i) {
+                ASSERT_HINT(exhaustive[i].id == max_score[i].id, "MaxScore must not change the ranking");
+            }
+        }
+    }
+}
+
+namespace {
+
+// выдача по id, чтобы равные по релевантности документы не зависели от порядка сортировки
+std::vector<Document> SortById(std::vector<Document> documents)
+{
+    std::sort(documents.begin(), documents.end(), [](const Document& lhs, const Document& rhs) {
+        return lhs.id < rhs.id;
+    });
+    return documents;
+}
+
+void AssertSameResults(const std::vector<Document>& expected, const std::vector<Document>& actual, const std::string& hint)
+{
+    const auto sorted_expected = SortById(expected);
+    const auto sorted_actual = SortById(actual);
+    ASSERT_HINT(sorted_expected.size() == sorted_actual.size(), hint);
+    for (size_t i = 0; i < sorted_expected.size(); ++i) {
+        ASSERT_HINT(sorted_expected[i].id == sorted_actual[i].id, hint);
+        ASSERT_HINT(std::abs(sorted_expected[i].relevance - sorted_actual[i].relevance) < EPSILON, hint);
+        ASSERT_HINT(sorted_expected[i].rating == sorted_actual[i].rating, hint);
+    }
+}
+
+}
+
+void TestBulkAddMatchesSequential()
+{
+    const std::vector<std::string> words = { "cat", "dog", "fluffy", "tail", "collar", "eyes", "city", "bird" };
+    std::vector<std::string> texts;
+    for (int id = 0; id < 500; ++id) {
+        texts.push_back(words[id % 8] + " " + words[id * 3 % 7] + " and " + words[id * 5 % 8] + " w" + std::to_string(id % 37));
+    }
+
+    SearchServer sequential(std::string("and"));
+    SearchServer bulk(std::string("and"));
+    SearchServer parallel_bulk(std::string("and"));
+    // часть слов уже есть в словаре до пакета
+    for (SearchServer* search_server : { &sequential, &bulk, &parallel_bulk }) {
+        search_server->AddDocument(1000, "fluffy cat w1", DocumentStatus::ACTUAL, { 5 });
+    }
+
+    std::vector<DocumentToAdd> documents;
+    for (int id = 0; id < 500; ++id) {
+        const DocumentStatus status = id % 9 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+        sequential.AddDocument(id, texts[id], status, { id % 10, -id % 4 });
+        documents.push_back({ id, texts[id], status, { id % 10, -id % 4 } });
+    }
+    bulk.AddDocuments(std::execution::seq, documents);
+    parallel_bulk.AddDocuments(std::execution::par, documents);
+
+    for (const SearchServer* search_server : { &bulk, &parallel_bulk }) {
+        ASSERT_HINT(std::equal(sequential.begin(), sequential.end(), search_server->begin(), search_server->end()),
+                    "AddDocuments must keep the order of documents");
+        for (const int id : sequential) {
+            ASSERT_HINT(sequential.GetWordFrequencies(id) == search_server->GetWordFrequencies(id), "AddDocuments must count the same word frequencies");
+        }
+        const SearchOptions all_results = { 0, 1000, SearchEngine::EXHAUSTIVE };
+        for (const std::string query : { "cat", "fluffy tail -dog", "w1 w2 bird", "city eyes collar" }) {
+            AssertSameResults(sequential.FindTopDocuments(query, DocumentStatus::ACTUAL, all_results),
+                              search_server->FindTopDocuments(query, DocumentStatus::ACTUAL, all_results),
+                              "AddDocuments must give the same results as AddDocument: " + query);
+            AssertSameResults(sequential.FindTopDocuments(query, DocumentStatus::BANNED, all_results),
+                              search_server->FindTopDocuments(query, DocumentStatus::BANNED, all_results),
+                              "AddDocuments must keep document statuses: " + query);
+        }
+    }
+}
+
+void TestCompressedPostingsMatchPlain()
+{
+    // "cat" есть в каждом документе: полные блоки из подряд идущих номеров
+    SearchServer plain(std::string("and"));
+    SearchServer compressed(std::string("and"));
+    for (int id = 0; id < 300; ++id) {
+        const std::string text = "cat " + std::string(id % 3 == 0 ? "dog " : "") + std::string(id % 7 == 0 ? "bird" : "fish");
+        plain.AddDocument(id, text, DocumentStatus::ACTUAL, { id % 10 });
+        compressed.AddDocument(id, text, DocumentStatus::ACTUAL, { id % 10 });
+    }
+    compressed.CompressPostings();
+
+    // документы после сжатия попадают в несжатый хвост и запечатываются в новые блоки
+    for (int id = 300; id < 450; ++id) {
+        plain.AddDocument(id, "cat dog", DocumentStatus::ACTUAL, { 1 });
+        compressed.AddDocument(id, "cat dog", DocumentStatus::ACTUAL, { 1 });
+    }
+    for (int id = 0; id < 450; id += 5) {
+        plain.RemoveDocument(id);
+        compressed.RemoveDocument(id);
+    }
+
+    const SearchOptions all_results = { 0, 1000, SearchEngine::EXHAUSTIVE };
+    for (const std::string query : { "cat", "dog", "bird -dog", "cat fish -bird", "cat dog bird fish" }) {
+        AssertSameResults(plain.FindTopDocuments(query, DocumentStatus::ACTUAL, all_results),
+                          compressed.FindTopDocuments(query, DocumentStatus::ACTUAL, all_results),
+                          "Compressed postings must give the same results as plain ones: " + query);
+    }
+    ASSERT_HINT(compressed.GetPostingMemoryUsage() < plain.GetPostingMemoryUsage(), "Dense postings must take less memory after compression");
+}
+
+void TestRejectedDuplicatesLeaveServerUnchanged()
+{
+    SearchServer search_server(std::string("and"));
+    search_server.SetDuplicatePolicy(DuplicatePolicy::REJECT);
+    search_server.AddDocument(1, "white cat and collar", DocumentStatus::ACTUAL, { 1 });
+    const uint64_t generation = search_server.GetGeneration();
+
+    bool rejected = false;
+    try {
+        search_server.AddDocument(2, "collar and white cat cat", DocumentStatus::ACTUAL, { 2 });
+    }
+    catch (const std::invalid_argument&) {
+        rejected = true;
+    }
+    ASSERT_HINT(rejected, "A duplicate must be rejected");
+
+    // новые слова пакета не должны остаться в словаре после отказа
+    rejected = false;
+    try {
+        search_server.AddDocuments({ { 3, "fluffy dog", DocumentStatus::ACTUAL, { 3 } },
+                                     { 4, "cat collar white", DocumentStatus::ACTUAL, { 4 } } });
+    }
+    catch (const std::invalid_argument&) {
+        rejected = true;
+    }
+    ASSERT_HINT(rejected, "A batch with a duplicate must be rejected");
+    ASSERT_HINT(search_server.GetDocumentCount() == 1, "A rejected batch must not add documents");
+    ASSERT_HINT(search_server.GetGeneration() == generation, "A rejected batch must not change the index");
+    ASSERT_HINT(search_server.FindTopDocuments("fluffy dog -collar").empty(), "Words of a rejected batch must not be found");
+
+    search_server.AddDocuments({ { 3, "fluffy dog", DocumentStatus::ACTUAL, { 3 } } });
+    const auto found_docs = search_server.FindTopDocuments("fluffy -collar");
+    ASSERT_HINT(found_docs.size() == 1 && found_docs[0].id == 3, "The batch must be indexed once the duplicate is gone");
+
+    // одинаковые документы проиндексированы до включения политики: после удаления раннего остаётся второй
+    SearchServer late_policy(std::string("and"));
+    late_policy.AddDocument(1, "cat dog", DocumentStatus::ACTUAL, { 1 });
+    late_policy.AddDocument(2, "dog cat", DocumentStatus::ACTUAL, { 2 });
+    late_policy.SetDuplicatePolicy(DuplicatePolicy::REJECT);
+    late_policy.RemoveDocument(1);
+    rejected = false;
+    try {
+        late_policy.AddDocument(3, "cat dog", DocumentStatus::ACTUAL, { 3 });
+    }
+    catch (const std::invalid_argument&) {
+        rejected = true;
+    }
+    ASSERT_HINT(rejected && late_policy.GetDocumentCount() == 1, "A duplicate of a remaining identical document must be rejected");
+}
+
+void TestDuplicateAliasesResolveToOriginal()
+{
+    SearchServer search_server(std::string("and"));
+    search_server.SetDuplicatePolicy(DuplicatePolicy::ALIAS);
+    search_server.AddDocument(1, "white cat and collar", DocumentStatus::BANNED, { 1 });
+    search_server.AddDocument(2, "collar white cat", DocumentStatus::ACTUAL, { 2 });
+
+    ASSERT_HINT(search_server.GetDocumentCount() == 1, "An alias must not be indexed");
+    ASSERT_HINT(search_server.ResolveDocumentId(2) == 1, "An alias must resolve to the original");
+    const auto [words, status] = search_server.MatchDocument("cat dog", 2);
+    ASSERT_HINT(words.size() == 1 && words[0] == "cat" && status == DocumentStatus::BANNED, "MatchDocument must answer for an alias with the original");
+    ASSERT_HINT(search_server.GetWordFrequencies(2) == search_server.GetWordFrequencies(1), "Word frequencies of an alias are those of the original");
+
+    search_server.RemoveDocument(1);
+    ASSERT_HINT(search_server.ResolveDocumentId(2) == 2 && search_server.GetWordFrequencies(2).empty(), "Removing the original must remove its aliases");
+}
+
+void TestNearDuplicateChainsAreSplit()
+{
+    // каждый следующий документ отличается от предыдущего одним словом: J соседей 9/11, J(1, 6) = 1/3
+    SearchServer search_server;
+    for (int id = 1; id <= 6; ++id) {
+        std::string text;
+        for (int word = id; word < id + 10; ++word) {
+            text += "w" + std::to_string(word) + " ";
+        }
+        search_server.AddDocument(id, text, DocumentStatus::ACTUAL, { 1 });
+    }
+
+    const auto clusters = FindNearDuplicates(search_server, { 0.8 });
+    ASSERT_HINT(clusters == std::vector<std::vector<int>>({ { 1, 2 }, { 3, 4 }, { 5, 6 } }),
+                "Every cluster member must be close to the representative, not just to a neighbour");
+}
+
+void TestRemovalKeepsDocumentOrder()
+{
+    // удаляется больше половины документов и больше MIN_COMPACTED_ORDINALS, так что номера уплотняются, в том числе в сжатых списках
+    SearchServer search_server(std::string("and"));
+    SearchServer expected(std::string("and"));
+    for (int id = 0; id < 4000; ++id) {
+        const std::string text = "cat " + std::string(id % 2 == 0 ? "dog" : "fish") + (id % 5 == 0 ? " bird" : "");
+        search_server.AddDocument(id, text, DocumentStatus::ACTUAL, { id % 10 });
+        if (id % 4 == 3) {
+            expected.AddDocument(id, text, DocumentStatus::ACTUAL, { id % 10 });
+        }
+    }
+    search_server.CompressPostings();
+
+    std::vector<int> batch;
+    for (int id = 0; id < 4000; ++id) {
+        if (id % 4 == 0) {
+            search_server.RemoveDocument(id);
+        }
+        else if (id % 4 != 3) {
+            batch.push_back(id);
+        }
+    }
+    search_server.RemoveDocuments(batch);
+    search_server.AddDocument(4000, "cat bird", DocumentStatus::ACTUAL, { 4 });
+    expected.AddDocument(4000, "cat bird", DocumentStatus::ACTUAL, { 4 });
+
+    ASSERT_HINT(search_server.GetDocumentCount() == expected.GetDocumentCount(), "Removed documents must not be counted");
+    for (int index = 0; index < expected.GetDocumentCount(); ++index) {
+        ASSERT_HINT(search_server.GetDocumentId(index) == expected.GetDocumentId(index), "GetDocumentId must follow the order of addition");
+    }
+    ASSERT_HINT(std::equal(search_server.begin(), search_server.end(), expected.begin(), expected.end()), "Iteration must skip removed documents");
+    ASSERT_HINT(search_server.GetWordFrequencies(399) == expected.GetWordFrequencies(399), "Word frequencies must survive removals");
+
+    const SearchOptions all_results = { 0, 1000, SearchEngine::EXHAUSTIVE };
+    for (const std::string query : { "cat", "dog -bird", "fish bird" }) {
+        AssertSameResults(expected.FindTopDocuments(query, DocumentStatus::ACTUAL, all_results),
+                          search_server.FindTopDocuments(query, DocumentStatus::ACTUAL, all_results),
+                          "Removals must not change results of the remaining documents: " + query);
+    }
+}
+
+void TestSnapshotRoundTrip()
+{
+    SearchServer search_server(std::string("and in"));
+    search_server.SetDuplicatePolicy(DuplicatePolicy::ALIAS);
+    for (int id = 0; id < 200; ++id) {
+        const std::string text = "cat " + std::string(id % 3 == 0 ? "fluffy " : "groomed ") + "in w" + std::to_string(id % 29);
+        search_server.AddDocument(id, text, id % 11 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL, { id % 10 });
+    }
+    // дубликат документа 3 становится его псевдонимом
+    search_server.AddDocument(500, "w3 fluffy in cat", DocumentStatus::ACTUAL, { 1 });
+    for (int id = 1; id < 200; id += 4) {
+        search_server.RemoveDocument(id);
+    }
+
+    const std::string path = (std::filesystem::temp_directory_path() / "search_server_test.snapshot").string();
+    search_server.SaveSnapshot(path);
+    const SearchServer loaded = SearchServer::LoadSnapshot(path);
+    std::filesystem::remove(path);
+
+    ASSERT_HINT(std::equal(search_server.begin(), search_server.end(), loaded.begin(), loaded.end()), "Snapshot must keep live documents in order");
+    for (const int id : search_server) {
+        ASSERT_HINT(search_server.GetWordFrequencies(id) == loaded.GetWordFrequencies(id), "Snapshot must keep word frequencies");
+    }
+    ASSERT_HINT(loaded.GetWordFrequencies(500) == search_server.GetWordFrequencies(3), "Snapshot must keep aliases");
+    ASSERT_HINT(std::get<0>(loaded.MatchDocument("fluffy cat -groomed", 500)).size() == 2, "Aliases must match with the original's words");
+
+    const SearchOptions all_results = { 0, 1000, SearchEngine::EXHAUSTIVE };
+    for (const std::string query : { "cat", "fluffy w3 -groomed", "groomed in w7" }) {
+        AssertSameResults(search_server.FindTopDocuments(query, DocumentStatus::ACTUAL, all_results),
+                          loaded.FindTopDocuments(query, DocumentStatus::ACTUAL, all_results),
+                          "Snapshot must give the same results: " + query);
+        AssertSameResults(search_server.FindTopDocuments(query, DocumentStatus::BANNED, all_results),
+                          loaded.FindTopDocuments(query, DocumentStatus::BANNED, all_results),
+                          "Snapshot must keep document statuses: " + query);
+    }
+
+    // после загрузки сжатого снимка новые документы тоже индексируются сжато
+    search_server.CompressPostings();
+    search_server.SaveSnapshot(path);
+    SearchServer compressed_loaded = SearchServer::LoadSnapshot(path);
+    std::filesystem::remove(path);
+    SearchServer plain_loaded = loaded;
+    for (int id = 1000; id < 1300; ++id) {
+        compressed_loaded.AddDocument(id, "cat dog w" + std::to_string(id), DocumentStatus::ACTUAL, { 1 });
+        plain_loaded.AddDocument(id, "cat dog w" + std::to_string(id), DocumentStatus::ACTUAL, { 1 });
+    }
+    ASSERT_HINT(compressed_loaded.GetPostingMemoryUsage() < plain_loaded.GetPostingMemoryUsage(), "Snapshot must keep postings compressed");
+    AssertSameResults(plain_loaded.FindTopDocuments("cat dog", DocumentStatus::ACTUAL, all_results),
+                      compressed_loaded.FindTopDocuments("cat dog", DocumentStatus::ACTUAL, all_results),
+                      "A compressed snapshot must give the same results");
+}
+
+void TestConcurrentRequestQueueMatchesRequestQueue()
+{
+    SearchServer search_server(std::string("and"));
+    search_server.AddDocument(1, "curly cat curly tail", DocumentStatus::ACTUAL, { 7, 2, 7 });
+    search_server.AddDocument(2, "big dog fancy collar", DocumentStatus::BANNED, { 1, 2, 3 });
+
+    RequestQueue request_queue(search_server);
+    ConcurrentRequestQueue concurrent_queue(search_server);
+    const SearchOptions options = { 0, 1, SearchEngine::EXHAUSTIVE };
+    for (int request = 0; request < 5000; ++request) {
+        // пустые выдачи идут сериями разной длины, чтобы окно то заполнялось ими, то освобождалось
+        const std::string query = (request / 700) % 2 == 0 && request % 3 != 0 ? "empty request" : "curly dog";
+        switch (request % 3) {
+        case 0:
+            request_queue.AddFindRequest(query);
+            concurrent_queue.AddFindRequest(query);
+            break;
+        case 1:
+            request_queue.AddFindRequest(query, DocumentStatus::BANNED, options);
+            concurrent_queue.AddFindRequest(query, DocumentStatus::BANNED, options);
+            break;
+        default:
+            const auto predicate = [](int document_id, DocumentStatus, int) { return document_id % 2 == 1; };
+            request_queue.AddFindRequest(query, predicate, options);
+            concurrent_queue.AddFindRequest(query, predicate, options);
+        }
+        ASSERT_HINT(request_queue.GetNoResultRequests() == concurrent_queue.GetNoResultRequests(),
+                    "ConcurrentRequestQueue must count the same requests as RequestQueue");
+    }
+
+    // из многих потоков: сначала окно целиком заполняется пустыми выдачами, затем целиком вытесняется непустыми
+    ConcurrentRequestQueue shared_queue(search_server);
+    const auto run_threads = [&shared_queue](const std::string& query) {
+        std::vector<std::thread> threads;
+        for (int thread = 0; thread < 4; ++thread) {
+            threads.emplace_back([&shared_queue, &query] {
+                for (int request = 0; request < 1000; ++request) {
+                    shared_queue.AddFindRequest(query);
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    };
+    run_threads("empty request");
+    ASSERT_HINT(shared_queue.GetNoResultRequests() == 1440, "Concurrent requests must fill the whole window");
+    run_threads("curly cat");
+    ASSERT_HINT(shared_queue.GetNoResultRequests() == 0, "Concurrent requests must push old requests out of the window");
+}
+
+namespace {
+
+// эталон для TokenizeText: побайтовый проход без блоков
+TokenizedText TokenizeByBytes(std::string_view text)
+{
+    TokenizedText result;
+    result.first_invalid_word = text.npos;
+    size_t word_begin = text.npos;
+    bool word_is_invalid = false;
+    for (size_t i = 0; i <= text.size(); ++i) {
+        if (i == text.size() || text[i] == ' ') {
+            if (word_begin != text.npos) {
+                if (word_is_invalid && result.first_invalid_word == text.npos) {
+                    result.first_invalid_word = result.words.size();
+                }
+                result.words.push_back(text.substr(word_begin, i - word_begin));
+                word_begin = text.npos;
+                word_is_invalid = false;
+            }
+            continue;
+        }
+        if (word_begin == text.npos) {
+            word_begin = i;
+        }
+        word_is_invalid = word_is_invalid || static_cast<unsigned char>(text[i]) < ' ';
+    }
+    if (result.first_invalid_word == text.npos) {
+        result.first_invalid_word = result.words.size();
+    }
+    return result;
+}
+
+void AssertSameTokens(const std::string& text)
+{
+    const TokenizedText expected = TokenizeByBytes(text);
+    const TokenizedText actual = TokenizeText(text);
+    ASSERT_HINT(expected.words == actual.words, "TokenizeText must split like a byte loop, text length " + std::to_string(text.size()));
+    ASSERT_HINT(expected.first_invalid_word == actual.first_invalid_word, "TokenizeText must find the first invalid word");
+    ASSERT_HINT(ContainsControlChars(text) == (expected.first_invalid_word < expected.words.size()), "ContainsControlChars must agree with TokenizeText");
+}
+
+}
+
+void TestTokenizeTextMatchesByteLoop()
+{
+    // слово и серия пробелов на границах 64-байтовых блоков, полный последний блок, байты 0x80-0xFF
+    AssertSameTokens(std::string(63, 'a') + " " + std::string(64, 'b'));
+    AssertSameTokens(std::string(60, 'a') + std::string(10, ' ') + "cat" + std::string(58, ' ') + "dog");
+    AssertSameTokens(std::string(64, ' ') + std::string(64, 'x'));
+    AssertSameTokens(std::string(127, ' ') + "\x80");
+    AssertSameTokens("cat \xD0\xBA\xD0\xBE\xD1\x82 " + std::string(70, '\xFF') + " dog");
+    AssertSameTokens(std::string(100, 'a') + " b\tc " + std::string(30, 'd') + "\x1F");
+
+    std::mt19937 generator(42);
+    const std::string alphabet = std::string("ab  \x7F\x80\xC3\xFF") + '\t' + '\x01';
+    for (int round = 0; round < 2000; ++round) {
+        std::string text(generator() % 300, ' ');
+        // управляющие символы редки, чтобы первое неверное слово оказывалось в разных местах
+        for (char& c : text) {
+            c = alphabet[generator() % (generator() % 50 == 0 ? alphabet.size() : alphabet.size() - 2)];
+        }
+        AssertSameTokens(text);
+    }
+}
+
+namespace {
+
+// внешнее состояние, которое читает предикат без захватов
+int banned_document_id = 0;
+
+}
+
+void TestRequestQueueCache()
+{
+    SearchServer search_server(std::string("and"));
+    search_server.AddDocument(1, "curly cat", DocumentStatus::ACTUAL, { 1 });
+    search_server.AddDocument(2, "curly dog", DocumentStatus::ACTUAL, { 2 });
+    RequestQueue request_queue(search_server);
+
+    ASSERT_HINT(request_queue.AddFindRequest("curly").size() == 2, "Both documents must be found");
+    ASSERT_HINT(request_queue.AddFindRequest("curly").size() == 2, "A cached result must be returned");
+    ASSERT_HINT(request_queue.GetCacheStats().hits == 1, "A repeated query must hit the cache");
+
+    // изменение индекса делает кеш недействительным
+    search_server.AddDocument(3, "curly tail", DocumentStatus::ACTUAL, { 3 });
+    ASSERT_HINT(request_queue.AddFindRequest("curly").size() == 3, "A result cached before AddDocument must not be returned");
+    search_server.RemoveDocument(1);
+    ASSERT_HINT(request_queue.AddFindRequest("curly").size() == 2, "A result cached before RemoveDocument must not be returned");
+    ASSERT_HINT(request_queue.GetCacheStats().hits == 1, "A changed index must miss the cache");
+
+    // без отметки предикат вызывается при каждом запросе, даже если у него нет захватов
+    const auto not_banned = [](int document_id, DocumentStatus, int) { return document_id != banned_document_id; };
+    banned_document_id = 2;
+    ASSERT_HINT(request_queue.AddFindRequest("curly", not_banned).size() == 1, "The predicate must be applied");
+    banned_document_id = 3;
+    const auto found_docs = request_queue.AddFindRequest("curly", not_banned);
+    ASSERT_HINT(found_docs.size() == 1 && found_docs[0].id == 2, "An unmarked predicate must not be cached");
+
+    const auto odd = [](int document_id, DocumentStatus, int) { return document_id % 2 == 1; };
+    request_queue.AddFindRequest("curly", odd, PURE_PREDICATE);
+    const size_t hits = request_queue.GetCacheStats().hits;
+    ASSERT_HINT(request_queue.AddFindRequest("curly", odd, PURE_PREDICATE).size() == 1, "A marked predicate must give the same result");
+    ASSERT_HINT(request_queue.GetCacheStats().hits == hits + 1, "A marked predicate must be cached");
+}
+
+void TestProcessQueries()
+{
+    SearchServer search_server(std::string("and with"));
+    for (int id = 1; id <= 20; ++id) {
+        search_server.AddDocument(id, "funny pet and nasty rat " + std::to_string(id % 4), DocumentStatus::ACTUAL, { id });
+    }
+    const std::vector<std::string> queries = { "nasty rat -not", "not very funny nasty pet", "nothing here", "curly hair", "pet 1 2" };
+
+    const auto results = ProcessQueries(search_server, queries);
+    ASSERT_HINT(results.size() == queries.size(), "ProcessQueries must answer every query");
+    std::vector<Document> expected;
+    for (size_t i = 0; i < queries.size(); ++i) {
+        const auto found_docs = search_server.FindTopDocuments(queries[i]);
+        AssertSameResults(found_docs, results[i], "ProcessQueries must give the results of FindTopDocuments: " + queries[i]);
+        expected.insert(expected.end(), found_docs.begin(), found_docs.end());
+    }
+
+    // пустые выдачи посередине и в конце пропускаются
+    const JoinedDocuments joined = ProcessQueriesJoined(search_server, queries);
+    ASSERT_HINT(joined.size() == expected.size(), "ProcessQueriesJoined must count all documents");
+    ASSERT_HINT(static_cast<size_t>(std::distance(joined.begin(), joined.end())) == expected.size(), "ProcessQueriesJoined must walk all documents");
+    size_t index = 0;
+    for (const Document& document : joined) {
+        ASSERT_HINT(document.id == expected[index].id && document.rating == expected[index].rating, "ProcessQueriesJoined must keep the order of queries");
+        ++index;
+    }
+    const JoinedDocuments empty_joined = ProcessQueriesJoined(search_server, { "nothing", "curly" });
+    ASSERT_HINT(empty_joined.begin() == empty_joined.end() && empty_joined.size() == 0, "Empty results must give an empty sequence");
+
+    // ошибка некорректного запроса доходит до вызывающего, а не завершает программу
+    for (const bool joined_results : { false, true }) {
+        std::string error;
+        try {
+            if (joined_results) {
+                ProcessQueriesJoined(search_server, { "funny", "--dog", "rat -" });
+            }
+            else {
+                ProcessQueries(search_server, { "funny", "--dog", "rat -" });
+            }
+        }
+        catch (const std::invalid_argument& e) {
+            error = e.what();
+        }
+        ASSERT_HINT(error.find("--dog") != std::string::npos, "The error of the first malformed query must be rethrown");
+    }
+}
+
+void TestPaginator()
+{
+    // прямые итераторы: страницы перебираются по порядку, последняя неполная
+    const std::forward_list<int> numbers = { 1, 2, 3, 4, 5, 6, 7 };
+    const auto pages = Paginate(numbers, 3);
+    ASSERT_HINT(pages.size() == 3, "Seven items must fit on three pages");
+    std::vector<std::vector<int>> page_items;
+    for (auto page = pages.begin(); page != pages.end(); ++page) {
+        page_items.emplace_back(page->begin(), page->end());
+        ASSERT_HINT(page->size() == (*page).size(), "operator-> and operator* must give the same page");
+    }
+    ASSERT_HINT(page_items == std::vector<std::vector<int>>({ { 1, 2, 3 }, { 4, 5, 6 }, { 7 } }), "Pages must split a forward_list in order");
+    ASSERT_HINT(std::distance(pages.begin(), pages.end()) == 3, "Pages must be countable by walking them");
+
+    const std::vector<int> empty;
+    const auto empty_pages = Paginate(empty, 2);
+    ASSERT_HINT(empty_pages.size() == 0 && empty_pages.begin() == empty_pages.end(), "An empty range must have no pages");
+    const std::forward_list<int> empty_list;
+    ASSERT_HINT(Paginate(empty_list, 2).size() == 0, "An empty forward_list must have no pages");
+
+    const std::vector<int> vector_numbers(numbers.begin(), numbers.end());
+    const auto vector_pages = Paginate(vector_numbers, 3);
+    ASSERT_HINT(vector_pages[2].size() == 1 && *vector_pages[1].begin() == 4, "Pages must be reachable by index with random access iterators");
+}
+
+void TestFindDuplicatesExternal()
+{
+    const SearchServer search_server(std::string("and with"));
+    const std::vector<std::string> words = { "cat", "dog", "rat", "pet", "tail" };
+    std::string input;
+    std::vector<int> expected;
+    std::map<std::set<std::string>, int> originals;
+    for (int id = 0; id < 60; ++id) {
+        // наборы из двух слов часто повторяются, порядок слов, повторы и стоп-слова не важны
+        const std::string first = words[id * 7 % 5];
+        const std::string second = words[id * 3 % 4];
+        const std::string text = id % 2 == 0 ? first + " and " + second : second + " " + first + " with " + second;
+        input += std::to_string(id) + " " + text + (id % 3 == 0 ? "\r\n" : "\n");
+        if (id % 10 == 0) {
+            input += "\n";
+        }
+        if (!originals.emplace(std::set<std::string>{ first, second }, id).second) {
+            expected.push_back(id);
+        }
+    }
+
+    // серии по две записи, сливаемые по две: несколько проходов слияния
+    for (const ExternalDedupOptions options : { ExternalDedupOptions{ 2, 2 }, ExternalDedupOptions{ 7, 3 }, ExternalDedupOptions{} }) {
+        std::istringstream documents(input);
+        ASSERT_HINT(FindDuplicatesExternal(documents, search_server, options) == expected,
+                    "External dedup must find later documents with the same words, run_size " + std::to_string(options.run_size));
+    }
+
+    std::istringstream invalid_documents("1 cat dog\n2 dog cat\n3 cat \x01dog\n");
+    std::string error;
+    try {
+        FindDuplicatesExternal(invalid_documents, search_server, { 2, 2 });
+    }
+    catch (const std::invalid_argument& e) {
+        error = e.what();
+    }
+    ASSERT_HINT(error.find("line 3") != std::string::npos, "A control character must be reported with its line number");
+}
+
+void TestQueryExecutor()
+{
+    SearchServer search_server(std::string("and"));
+    search_server.AddDocument(1, "curly cat and curly tail", DocumentStatus::ACTUAL, { 7 });
+    search_server.AddDocument(2, "big dog", DocumentStatus::ACTUAL, { 1 });
+
+    {
+        QueryExecutor executor(search_server, 2);
+        auto found_docs = executor.SubmitFindTopDocuments("curly dog");
+        auto matched = executor.SubmitMatchDocument("curly -dog", 1);
+        AssertSameResults(search_server.FindTopDocuments("curly dog"), found_docs.get(), "The executor must give the results of FindTopDocuments");
+        ASSERT_HINT(std::get<0>(matched.get()) == std::vector<std::string_view>({ "curly" }), "The executor must give the results of MatchDocument");
+
+        // исключение некорректного запроса передаётся через future
+        auto malformed = executor.SubmitFindTopDocuments("--dog");
+        bool invalid = false;
+        try {
+            malformed.get();
+        }
+        catch (const std::invalid_argument&) {
+            invalid = true;
+        }
+        ASSERT_HINT(invalid, "A malformed query must forward invalid_argument");
+
+        auto expired = executor.SubmitFindTopDocuments("curly", QueryExecutor::Clock::now() - std::chrono::seconds(1));
+        bool deadline_exceeded = false;
+        try {
+            expired.get();
+        }
+        catch (const QueryDeadlineExceeded&) {
+            deadline_exceeded = true;
+        }
+        ASSERT_HINT(deadline_exceeded, "A task past its deadline must not run");
+    }
+
+    // один поток и очередь на одну задачу: третья задача ждёт, пока поток не освободится
+    QueryExecutor executor(search_server, 1, 1);
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    auto blocking = executor.Submit([released] {
+        released.wait();
+        return 1;
+    });
+    auto queued = executor.Submit([] {
+        return 2;
+    });
+    auto submitted = std::async(std::launch::async, [&executor] {
+        return executor.Submit([] {
+            return 3;
+        });
+    });
+    ASSERT_HINT(submitted.wait_for(std::chrono::milliseconds(100)) == std::future_status::timeout, "Submit must wait while the queue is full");
+    release.set_value();
+    auto third = submitted.get();
+    ASSERT_HINT(blocking.get() == 1 && queued.get() == 2 && third.get() == 3, "Queued tasks must run once the queue drains");
+}
+
+void TestSearchServer()
+{
+    TestAddingDocument();
+    TestCopiedServerOutlivesOriginal();
+    TestMaxScoreMatchesExhaustive();
+    TestBulkAddMatchesSequential();
+    TestSnapshotRoundTrip();
+    TestCompressedPostingsMatchPlain();
+    TestRejectedDuplicatesLeaveServerUnchanged();
+    TestDuplicateAliasesResolveToOriginal();
+    TestNearDuplicateChainsAreSplit();
+    TestRemovalKeepsDocumentOrder();
+    TestProcessQueries();
+    TestPaginator();
+    TestFindDuplicatesExternal();
+    TestQueryExecutor();
+    TestRequestQueueCache();
+    TestConcurrentRequestQueueMatchesRequestQueue();
+    TestTokenizeTextMatchesByteLoop();
+}